@@ -0,0 +1,63 @@
+#include "bench.h"
+#include <marrow/alloc.h>
+#include <marrow/vektor.h>
+
+// a VEKTOR(u32) grown one item at a time to N, with the vektor the only thing in its allocator so
+// every grow is a realloc of the last allocation. copied counts the bytes moved by grows that
+// didnt happen in place
+
+#define N (10 * 1000 * 1000)
+#define ARENA_CAPACITY (64 * 1024 * 1024)
+
+typedef struct { f64 seconds; usize copied; } GrowResult;
+
+static GrowResult grow(Allocator* allocator)
+{
+    VEKTOR(u32) v; vektor_init(v, 0, allocator);
+    usize copied = 0;
+    f64 start = bench_now();
+    for (u32 i = 0; i < N; i++) {
+        u32* before = v.items;
+        vektor_add(v, i);
+        if (before && v.items != before) copied += (usize)i * sizeof(u32);
+    }
+    GrowResult r = { bench_now() - start, copied };
+    bench_sink += v.items[N / 2];
+    vektor_free(v);
+    return r;
+}
+
+static usize bump_reserved(BumpAllocator* a)
+{
+    usize reserved = 0;
+    for (BumpAllocatorBlock* b = a->first; b; b = b->next) reserved += b->capacity;
+    return reserved;
+}
+
+static void row(cstr name, GrowResult r, usize reserved)
+{
+    printf("  %-28s %10.2f ms %8.1f MB copied %8.1f MB reserved\n", name, r.seconds * 1e3, r.copied / 1e6, reserved / 1e6);
+}
+
+int main(void)
+{
+    printf("VEKTOR(u32) grown to %d items\n", N);
+
+    // what every realloc did before: allocate, copy, leave the old one behind
+    BumpAllocator copying = { ._impl = { .alloc = _mrw_bump_alloc, .realloc = _mrw_fake_realloc, .free = _mrw_fake_free } };
+    GrowResult r = grow(&copying._impl);
+    row("bump, always copy", r, bump_reserved(&copying));
+    mrw_bump_free(&copying);
+
+    BumpAllocator bump = { MRW_BUMP_IMPL };
+    r = grow(&bump._impl);
+    row("bump, in place", r, bump_reserved(&bump));
+    mrw_bump_free(&bump);
+
+    // with copying the sum of every size it went through wouldnt fit
+    Arena arena = { MRW_ARENA_IMPL, .data = _mrw_alloc(nullptr, ARENA_CAPACITY, 64), .capacity = ARENA_CAPACITY };
+    r = grow(&arena._impl);
+    row("arena 64 MB, in place", r, arena.used);
+    _mrw_free(nullptr, arena.data, ARENA_CAPACITY);
+    return 0;
+}
@@ -0,0 +1,39 @@
+#ifndef MARROW_BENCH_H
+#define MARROW_BENCH_H
+
+#include <stdlib.h>
+#include <marrow/marrow.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// shared bits for the benchmarks, every one is a standalone program that prints its own table
+
+// seconds on a monotonic clock
+static inline f64 bench_now(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER freq, t;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return (f64)t.QuadPart / (f64)freq.QuadPart;
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (f64)t.tv_sec + (f64)t.tv_nsec * 1e-9;
+#endif
+}
+
+// the nth number of a fixed sequence, so every run and every variant sees the same input
+static inline u64 bench_rand(u64 n) { return hash_u64(n + 0x9e3779b97f4a7c15ULL); }
+
+// keeps the compiler from throwing away a result
+static volatile u64 bench_sink;
+
+#define bench_row(name, seconds, ops) \
+    printf("  %-28s %10.2f ms %10.2f ns/op\n", (name), (seconds) * 1e3, (seconds) * 1e9 / (f64)(ops))
+
+#endif // MARROW_BENCH_H
@@ -0,0 +1,61 @@
+#include "bench.h"
+#include <marrow/genarr.h>
+
+// random handle lookups into a GENARR and a GENARR_SPLIT holding the same 128 byte values, with a
+// quarter of the handles stale. genarr_is only needs the generation, get also reads one field of
+// the value, which the split layout keeps in a second array
+
+#define LOOKUPS (4 * 1000 * 1000)
+
+typedef struct { u64 id; u8 payload[120]; } Value;
+
+static GenarrHandle handles[LOOKUPS];
+
+int main(void)
+{
+    static const u32 slot_counts[] = { 1000, 10000, 100000, 1000000 };
+    printf("%d random lookups, 1/4 of the handles stale, %d byte values, ns per lookup\n", LOOKUPS, (int)sizeof(Value));
+    printf("  %-10s %21s %21s\n", "", "genarr_is", "get + read one field");
+    printf("  %-10s %10s %10s %10s %10s\n", "slots", "genarr", "split", "genarr", "split");
+
+    for (u32 c = 0; c < array_len(slot_counts); c++) {
+        u32 n = slot_counts[c];
+        GENARR(Value) plain; genarr_init(plain, 0, nullptr);
+        GENARR_SPLIT(Value) split; genarr_split_init(split, 0, nullptr);
+        GenarrHandle* slots = _mrw_alloc(nullptr, n * sizeof(GenarrHandle), alignof(GenarrHandle));
+        for (u32 i = 0; i < n; i++) {
+            slots[i] = genarr_add(plain, (Value){ .id = i });
+            genarr_split_add(split, (Value){ .id = i });
+        }
+        for (u32 i = 0; i < n; i += 4) {
+            genarr_remove(plain, slots[i]);
+            genarr_remove(split, slots[i]);
+        }
+        for (u32 i = 0; i < LOOKUPS; i++) handles[i] = slots[bench_rand(i) % n];
+
+        f64 seconds[4];
+        u64 hits = 0;
+        f64 start = bench_now();
+        for (u32 i = 0; i < LOOKUPS; i++) hits += genarr_is(plain, handles[i]);
+        seconds[0] = bench_now() - start;
+        start = bench_now();
+        for (u32 i = 0; i < LOOKUPS; i++) hits += genarr_is(split, handles[i]);
+        seconds[1] = bench_now() - start;
+        start = bench_now();
+        for (u32 i = 0; i < LOOKUPS; i++) { Value* v = genarr_get(plain, handles[i]); if (v) hits += v->id; }
+        seconds[2] = bench_now() - start;
+        start = bench_now();
+        for (u32 i = 0; i < LOOKUPS; i++) { Value* v = genarr_split_get(split, handles[i]); if (v) hits += v->id; }
+        seconds[3] = bench_now() - start;
+        bench_sink += hits;
+
+        printf("  %-10u", n);
+        for (u32 i = 0; i < 4; i++) printf(" %10.2f", seconds[i] * 1e9 / LOOKUPS);
+        printf("\n");
+
+        _mrw_free(nullptr, slots, n * sizeof(GenarrHandle));
+        genarr_free(plain);
+        genarr_split_free(split);
+    }
+    return 0;
+}
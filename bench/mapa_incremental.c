@@ -0,0 +1,46 @@
+#include "bench.h"
+#include <marrow/mapa.h>
+#include <marrow/sort.h>
+
+// every insert of N random u64 keys timed on its own, into a MAPA that rehashes in one go when it
+// grows and one set up with mapa_init_incremental. the total includes the timer calls
+
+static void report(cstr name, f32* latencies, u64 n, f64 total)
+{
+    SLICE(f32) s = slice_to(latencies, n);
+    slice_radix_sort(s, nullptr);
+    printf("  %-12s %10.0f ms %10.0f ns %10.0f ns %10.2f ms\n", name, total * 1e3,
+        latencies[n / 2], latencies[n - n / 1000 - 1], latencies[n - 1] / 1e6);
+}
+
+int main(void)
+{
+    static const u64 key_counts[] = { 1000000, 5000000 };
+    printf("random u64 keys, per insert latency\n");
+    printf("  %-12s %13s %13s %13s %13s\n", "", "total", "median", "p99.9", "max");
+
+    for (u32 c = 0; c < array_len(key_counts); c++) {
+        u64 n = key_counts[c];
+        f32* latencies = _mrw_alloc(nullptr, n * sizeof(f32), alignof(f32));
+        printf("  %llu keys\n", (unsigned long long)n);
+
+        for (u32 incremental = 0; incremental < 2; incremental++) {
+            MAPA(u64, u64) m;
+            if (incremental) mapa_init_incremental(m, mapa_hash_u64, mapa_cmp_bytes, nullptr);
+            else mapa_init(m, mapa_hash_u64, mapa_cmp_bytes, nullptr);
+
+            f64 total_start = bench_now();
+            for (u64 i = 0; i < n; i++) {
+                u64 key = bench_rand(i);
+                f64 start = bench_now();
+                mapa_insert(m, &key, i);
+                latencies[i] = (f32)((bench_now() - start) * 1e9);
+            }
+            f64 total = bench_now() - total_start;
+            report(incremental ? "incremental" : "sync", latencies, n, total);
+            mapa_free(m);
+        }
+        _mrw_free(nullptr, latencies, n * sizeof(f32));
+    }
+    return 0;
+}
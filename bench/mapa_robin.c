@@ -0,0 +1,67 @@
+#include "bench.h"
+#include <marrow/mapa.h>
+#include <marrow/mapa_robin.h>
+
+// 32 byte random keys hashed with mapa_hash_fnv into a MAPA and a ROBIN_MAPA. hit looks up every
+// key that was inserted, miss the same number of keys that never were, then every key is removed
+
+typedef struct { u64 w[4]; } Key;
+
+static Key make_key(u64 n) { return (Key){ { bench_rand(4 * n), bench_rand(4 * n + 1), bench_rand(4 * n + 2), bench_rand(4 * n + 3) } }; }
+
+int main(void)
+{
+    static const u64 key_counts[] = { 3000000, 7000000 };
+    printf("32 byte keys, mapa_hash_fnv, ns per op\n");
+    printf("  %-8s %-12s %8s %8s %8s %8s %10s %6s\n", "keys", "", "insert", "hit", "miss", "remove", "table MB", "load");
+
+    for (u32 c = 0; c < array_len(key_counts); c++) {
+        u64 n = key_counts[c];
+        Key* keys = _mrw_alloc(nullptr, n * sizeof(Key), alignof(Key));
+        for (u64 i = 0; i < n; i++) keys[i] = make_key(i);
+        u64 sum = 0;
+        f64 t[4];
+
+        MAPA(Key, u64) m; mapa_init(m, mapa_hash_fnv, mapa_cmp_bytes, nullptr);
+        f64 start = bench_now();
+        for (u64 i = 0; i < n; i++) mapa_insert(m, &keys[i], i);
+        t[0] = bench_now() - start;
+        start = bench_now();
+        for (u64 i = 0; i < n; i++) { u64* v = mapa_get(m, &keys[i]); sum += v ? *v : 0; }
+        t[1] = bench_now() - start;
+        start = bench_now();
+        for (u64 i = 0; i < n; i++) { Key k = make_key(n + i); sum += mapa_get(m, &k) != nullptr; }
+        t[2] = bench_now() - start;
+        f64 mb = m.size * sizeof(*m.entries) / 1e6, load = (f64)n / m.size;
+        start = bench_now();
+        for (u64 i = 0; i < n; i++) mapa_remove(m, &keys[i]);
+        t[3] = bench_now() - start;
+        printf("  %-8llu %-12s", (unsigned long long)n, "MAPA");
+        for (u32 i = 0; i < 4; i++) printf(" %8.0f", t[i] * 1e9 / n);
+        printf(" %10.0f %6.2f\n", mb, load);
+        mapa_free(m);
+
+        ROBIN_MAPA(Key, u64) r; robin_mapa_init(r, mapa_hash_fnv, mapa_cmp_bytes, nullptr);
+        start = bench_now();
+        for (u64 i = 0; i < n; i++) robin_mapa_insert(r, &keys[i], i);
+        t[0] = bench_now() - start;
+        start = bench_now();
+        for (u64 i = 0; i < n; i++) { u64* v = robin_mapa_get(r, &keys[i]); sum += v ? *v : 0; }
+        t[1] = bench_now() - start;
+        start = bench_now();
+        for (u64 i = 0; i < n; i++) { Key k = make_key(n + i); sum += robin_mapa_get(r, &k) != nullptr; }
+        t[2] = bench_now() - start;
+        mb = r.size * (sizeof(*r.entries) + sizeof(u64)) / 1e6, load = (f64)n / r.size;
+        start = bench_now();
+        for (u64 i = 0; i < n; i++) robin_mapa_remove(r, &keys[i]);
+        t[3] = bench_now() - start;
+        printf("  %-8s %-12s", "", "ROBIN_MAPA");
+        for (u32 i = 0; i < 4; i++) printf(" %8.0f", t[i] * 1e9 / n);
+        printf(" %10.0f %6.2f\n", mb, load);
+        robin_mapa_free(r);
+
+        bench_sink += sum;
+        _mrw_free(nullptr, keys, n * sizeof(Key));
+    }
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include "bench.h"
+#include <marrow/mapa.h>
+#include <marrow/mapa_str.h>
+
+// counters keyed on "service.N.requests.latency_pM" labels, every op picks a random label and either
+// bumps its counter or adds it, then the same number of plain gets. the labels are built up front
+// in a buffer the maps dont own, so both have to copy a key the first time they see it. the hand
+// rolled version is what STR_MAPA replaces, a MAPA(str) with an fnv content hash that copies keys
+// into a bump allocator itself
+
+static u64 hash_str_fnv(const void* key, u64 key_size)
+{
+    str s = *(const str*)key;
+    return mapa_hash_fnv(s.start, str_len(s));
+}
+
+int main(void)
+{
+    static const u64 label_counts[] = { 100000, 1000000, 5000000 };
+    static const u32 percentiles[] = { 50, 90, 99, 999 };
+    printf("upserts then gets over random labels, ns per op\n");
+    printf("  %-10s %-12s %8s %8s\n", "labels", "", "upsert", "get");
+
+    for (u32 c = 0; c < array_len(label_counts); c++) {
+        u64 n = label_counts[c], ops = 2 * n;
+        char* text = _mrw_alloc(nullptr, n * 48, 1);
+        str* labels = _mrw_alloc(nullptr, n * sizeof(str), alignof(str));
+        char* cursor = text;
+        for (u64 i = 0; i < n; i++) {
+            int len = snprintf(cursor, 48, "service.%llu.requests.latency_p%u", (unsigned long long)(i / 4), percentiles[i % 4]);
+            labels[i] = (str)slice(cursor, cursor + len);
+            cursor += len;
+        }
+        u64 sum = 0;
+
+        MAPA(str, u64) m; mapa_init(m, hash_str_fnv, mapa_cmp_str, nullptr);
+        BumpAllocator keys = { MRW_BUMP_IMPL };
+        f64 start = bench_now();
+        for (u64 i = 0; i < ops; i++) {
+            str label = labels[bench_rand(i) % n];
+            u64* v = mapa_get(m, &label);
+            if (v) { (*v)++; continue; }
+            usize len = str_len(label);
+            char* copy = _mrw_alloc(&keys._impl, len, 1);
+            buf_copy(copy, label.start, len);
+            str owned = slice(copy, copy + len);
+            mapa_insert(m, &owned, 1);
+        }
+        f64 upsert = bench_now() - start;
+        start = bench_now();
+        for (u64 i = 0; i < ops; i++) { u64* v = mapa_get(m, &labels[bench_rand(ops + i) % n]); sum += v ? *v : 0; }
+        f64 get = bench_now() - start;
+        printf("  %-10llu %-12s %8.0f %8.0f\n", (unsigned long long)n, "hand rolled", upsert * 1e9 / ops, get * 1e9 / ops);
+        mapa_free(m);
+        mrw_bump_free(&keys);
+
+        STR_MAPA(u64) s; str_mapa_init(s, nullptr);
+        start = bench_now();
+        for (u64 i = 0; i < ops; i++) {
+            str label = labels[bench_rand(i) % n];
+            u64* v = str_mapa_get(s, label);
+            if (v) (*v)++;
+            else str_mapa_insert(s, label, 1);
+        }
+        upsert = bench_now() - start;
+        start = bench_now();
+        for (u64 i = 0; i < ops; i++) { u64* v = str_mapa_get(s, labels[bench_rand(ops + i) % n]); sum += v ? *v : 0; }
+        get = bench_now() - start;
+        printf("  %-10s %-12s %8.0f %8.0f\n", "", "STR_MAPA", upsert * 1e9 / ops, get * 1e9 / ops);
+        str_mapa_free(s);
+
+        bench_sink += sum;
+        _mrw_free(nullptr, labels, n * sizeof(str));
+        _mrw_free(nullptr, text, n * 48);
+    }
+    return 0;
+}
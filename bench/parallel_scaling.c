@@ -0,0 +1,68 @@
+#include "bench.h"
+#include <marrow/parallel.h>
+
+// the parallel sort, prefix sum and partition on N items with pools of 1 to 16 threads. the speedup
+// is against the 1 thread pool, which runs everything on the calling thread. past the number of
+// cores the box has the extra threads only add switching, so read the table with that in mind
+
+#define N (10 * 1000 * 1000)
+
+PARALLEL_SORT_DEFINE(bench_sort_u32, u32, *a < *b)
+PARALLEL_PARTITION_DEFINE(bench_partition_even, u32, (*a & 1) == 0)
+
+static const u32 thread_counts[] = { 1, 2, 4, 8, 16 };
+
+static void fill(u32* items)
+{
+    for (u32 i = 0; i < N; i++) items[i] = (u32)bench_rand(i);
+}
+
+static void row(cstr name, f64* seconds)
+{
+    printf("  %-14s", name);
+    for (u32 i = 0; i < array_len(thread_counts); i++) printf(" %8.1f ms %5.2fx", seconds[i] * 1e3, seconds[0] / seconds[i]);
+    printf("\n");
+}
+
+int main(void)
+{
+    printf("%d items\n  %-14s", N, "threads");
+    for (u32 i = 0; i < array_len(thread_counts); i++) printf(" %18u", thread_counts[i]);
+    printf("\n");
+
+    u32* items = _mrw_alloc(nullptr, N * sizeof(u32), alignof(u32));
+    u64* wide = _mrw_alloc(nullptr, N * sizeof(u64), alignof(u64));
+    SLICE(u64) wide_s = slice_to(wide, N);
+    f64 sort[array_len(thread_counts)], scan[array_len(thread_counts)], partition[array_len(thread_counts)];
+
+    for (u32 t = 0; t < array_len(thread_counts); t++) {
+        ThreadPool pool; mrw_thread_pool_init(&pool, thread_counts[t], nullptr);
+
+        fill(items);
+        f64 start = bench_now();
+        bench_sort_u32(items, N, &pool, nullptr);
+        sort[t] = bench_now() - start;
+        for (u32 i = 1; i < N; i++) if (items[i - 1] > items[i]) mrw_abort("not sorted");
+
+        for (u32 i = 0; i < N; i++) wide[i] = bench_rand(i) & 0xff;
+        start = bench_now();
+        slice_prefix_sum_parallel(wide, wide_s, &pool);
+        scan[t] = bench_now() - start;
+        bench_sink += wide[N - 1];
+
+        fill(items);
+        start = bench_now();
+        bench_sink += bench_partition_even(items, N, &pool, nullptr);
+        partition[t] = bench_now() - start;
+
+        mrw_thread_pool_free(&pool);
+    }
+
+    row("sort", sort);
+    row("prefix sum", scan);
+    row("partition", partition);
+
+    _mrw_free(nullptr, items, N * sizeof(u32));
+    _mrw_free(nullptr, wide, N * sizeof(u64));
+    return 0;
+}
@@ -0,0 +1,44 @@
+#include "bench.h"
+#include <marrow/alloc.h>
+
+// LIVE objects of 8..520 bytes, then every op frees a random one and allocates a new random size
+// in its place. the sizes and the order are the same for both allocators
+
+#define LIVE (16 * 1024)
+#define OPS (20 * 1000 * 1000)
+
+static void* ptrs[LIVE];
+static usize sizes[LIVE];
+
+static usize churn_size(u64 n) { return 8 + bench_rand(n) % 513; }
+
+static f64 churn(Allocator* a)
+{
+    for (u32 i = 0; i < LIVE; i++) {
+        sizes[i] = churn_size(i);
+        ptrs[i] = _mrw_alloc(a, sizes[i], 8);
+    }
+    f64 start = bench_now();
+    for (u64 op = 0; op < OPS; op++) {
+        u64 r = bench_rand(LIVE + op);
+        u32 i = (u32)(r % LIVE);
+        _mrw_free(a, ptrs[i], sizes[i]);
+        sizes[i] = churn_size(r >> 32);
+        ptrs[i] = _mrw_alloc(a, sizes[i], 8);
+        *(u8*)ptrs[i] = (u8)op;
+    }
+    f64 seconds = bench_now() - start;
+    for (u32 i = 0; i < LIVE; i++) _mrw_free(a, ptrs[i], sizes[i]);
+    return seconds;
+}
+
+int main(void)
+{
+    printf("%d free + alloc pairs, %d live objects of 8..520 bytes\n", OPS, LIVE);
+    bench_row("default allocator", churn(nullptr), OPS);
+
+    SlabAllocator slab = { MRW_SLAB_IMPL };
+    bench_row("SlabAllocator", churn(&slab._impl), OPS);
+    mrw_slab_free(&slab);
+    return 0;
+}
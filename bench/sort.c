@@ -0,0 +1,56 @@
+#include "bench.h"
+#include <marrow/sort.h>
+
+// N random u32 sorted by every sort in sort.h and by libc qsort, each starting from the same input
+
+#define N (10 * 1000 * 1000)
+
+static int cmp_u32(const void* a, const void* b)
+{
+    u32 x = *(const u32*)a, y = *(const u32*)b;
+    return (x > y) - (x < y);
+}
+
+static void fill(u32* items)
+{
+    for (u32 i = 0; i < N; i++) items[i] = (u32)bench_rand(i);
+}
+
+static void check(u32* items)
+{
+    for (u32 i = 1; i < N; i++) if (items[i - 1] > items[i]) mrw_abort("not sorted");
+}
+
+int main(void)
+{
+    printf("%d random u32\n", N);
+    u32* items = _mrw_alloc(nullptr, N * sizeof(u32), alignof(u32));
+    SLICE(u32) s = slice_to(items, N);
+
+    fill(items);
+    f64 start = bench_now();
+    qsort(items, N, sizeof(u32), cmp_u32);
+    bench_row("qsort", bench_now() - start, N);
+    check(items);
+
+    fill(items);
+    start = bench_now();
+    slice_sort(s, u32, *a < *b);
+    bench_row("slice_sort", bench_now() - start, N);
+    check(items);
+
+    fill(items);
+    start = bench_now();
+    slice_sort_stable(s, u32, *a < *b, nullptr);
+    bench_row("slice_sort_stable", bench_now() - start, N);
+    check(items);
+
+    fill(items);
+    start = bench_now();
+    slice_radix_sort(s, nullptr);
+    bench_row("slice_radix_sort", bench_now() - start, N);
+    check(items);
+
+    _mrw_free(nullptr, items, N * sizeof(u32));
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include "bench.h"
+#include <marrow/vektor.h>
+
+// removes and inserts at the front of a big VEKTOR(u32), so every op shifts the whole thing. the
+// loop variants shift one item at a time like vektor_insert and vektor_remove used to, at -O2 and up
+// compilers tend to turn those into a memmove anyway so the gap mostly shows in debug builds
+
+#define N (1000 * 1000)
+#define OPS 1000
+
+typedef VEKTOR(u32) U32Vektor;
+
+static void fill(U32Vektor* v)
+{
+    vektor_clear((*v));
+    for (u32 i = 0; i < N; i++) vektor_add((*v), i);
+}
+
+int main(void)
+{
+    printf("%d front removes and inserts on a VEKTOR(u32) of %d items\n", OPS, N);
+    U32Vektor v; vektor_init(v, N + 1, nullptr);
+
+    fill(&v);
+    f64 start = bench_now();
+    for (u32 i = 0; i < OPS; i++) {
+        for (u64 j = 0; j + 1 < v.n_items; j++) v.items[j] = v.items[j + 1];
+        v.n_items--;
+    }
+    bench_row("remove, item loop", bench_now() - start, OPS);
+
+    fill(&v);
+    start = bench_now();
+    for (u32 i = 0; i < OPS; i++) vektor_remove(v, 0);
+    bench_row("vektor_remove", bench_now() - start, OPS);
+
+    fill(&v);
+    start = bench_now();
+    for (u32 i = 0; i < OPS; i++) {
+        vektor_ensure(v, v.n_items);
+        for (u64 j = v.n_items; j > 0; j--) v.items[j] = v.items[j - 1];
+        v.items[0] = i;
+        v.n_items++;
+    }
+    bench_row("insert, item loop", bench_now() - start, OPS);
+
+    fill(&v);
+    start = bench_now();
+    for (u32 i = 0; i < OPS; i++) vektor_insert(v, 0, i);
+    bench_row("vektor_insert", bench_now() - start, OPS);
+
+    bench_sink += v.items[N / 2];
+    vektor_free(v);
+    return 0;
+}
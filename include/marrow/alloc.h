@@ -3,17 +3,41 @@
 
 #include "marrow.h"
 
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <malloc.h>
+#elif defined(__linux__)
+#include <sys/mman.h> // madvise for the huge page hint
+#endif // _WIN32
+
+// where the next allocation comes from, allocators that care (TrackingAllocator) read it. only
+// recorded with MRW_TRACK_CALLSITES defined, otherwise _mrw_here compiles to nothing. every
+// _mrw_alloc/_mrw_realloc/_mrw_free clears it on the way out and so do the container macros
+// that record it but end up not allocating, so it never sticks to an unrelated allocation
+typedef struct { cstr file; u32 line; } AllocCallsite;
+thread_local AllocCallsite _mrw_callsite;
+#ifdef MRW_TRACK_CALLSITES
+#define _mrw_here() (_mrw_callsite = (AllocCallsite){ .file = __FILE__, .line = __LINE__ })
+#define _mrw_here_end() (_mrw_callsite = (AllocCallsite){ 0 })
+#else
+#define _mrw_here() ((void)0)
+#define _mrw_here_end() ((void)0)
+#endif // MRW_TRACK_CALLSITES
+
 #define mrw_alloc(alloc, T)\
-    ((T*)_mrw_alloc((alloc), sizeof(T), alignof(T)))
+    ((T*)(_mrw_here(), _mrw_alloc((alloc), sizeof(T), alignof(T))))
 
 #define mrw_alloc_n(alloc, T, n)\
-    ((T*)_mrw_alloc((alloc), sizeof(T) * (n), alignof(T)))
+    ((T*)(_mrw_here(), _mrw_alloc((alloc), sizeof(T) * (n), alignof(T))))
 
 #define mrw_realloc(alloc, ptr, old_count, new_count, T)\
-    ((T*)_mrw_realloc((alloc), (ptr), sizeof(T) * (old_count), sizeof(T) * (new_count), alignof(T)))
+    ((T*)(_mrw_here(), _mrw_realloc((alloc), (ptr), sizeof(T) * (old_count), sizeof(T) * (new_count), alignof(T))))
 
 #define mrw_alloc_copy(alloc, src, count, T)\
-    ((T*)_mrw_alloc_copy((alloc), (src), sizeof(T) * (count), alignof(T)))
+    ((T*)(_mrw_here(), _mrw_alloc_copy((alloc), (src), sizeof(T) * (count), alignof(T))))
 
 #define mrw_free(alloc, src) _mrw_free((alloc), (src), sizeof(*(src)))
 
@@ -29,22 +53,87 @@ typedef struct Allocator {
     _mrw_alloc_free_func* free;
 } Allocator;
 
-static inline void* _mrw_default_alloc(Allocator* allocator, usize size, usize align) { return malloc(size); }
-static inline void* _mrw_default_realloc(Allocator* allocator, void* ptr, usize old_size, usize new_size, usize align) { return realloc(ptr, new_size); }
+// malloc already gives out this much alignment, anything stricter goes through the aligned path
+#ifndef MRW_MALLOC_ALIGN
+#define MRW_MALLOC_ALIGN alignof(max_align_t)
+#endif // MRW_MALLOC_ALIGN
+
+#define MRW_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+// opt in, default allocations of at least this many bytes get huge page aligned and
+// marked for transparent huge pages (linux only), 0 turns it off
+usize mrw_huge_page_threshold = 0;
+
+// windows cant free _aligned_malloc memory with free so everything goes through the aligned functions there
+#ifdef _WIN32
+static inline void* _mrw_default_alloc(Allocator* allocator, usize size, usize align) { return _aligned_malloc(size, max(align, MRW_MALLOC_ALIGN)); }
+static inline void* _mrw_default_realloc(Allocator* allocator, void* ptr, usize old_size, usize new_size, usize align) { return _aligned_realloc(ptr, new_size, max(align, MRW_MALLOC_ALIGN)); }
+static inline void  _mrw_default_free(Allocator* allocator, void* ptr, usize size) { _aligned_free(ptr); }
+#else
+static inline bool _mrw_default_is_huge(usize size) { return mrw_huge_page_threshold && size >= mrw_huge_page_threshold; }
+
+static inline void* _mrw_default_alloc(Allocator* allocator, usize size, usize align)
+{
+    if (_mrw_default_is_huge(size)) {
+        usize huge_align = max(align, MRW_HUGE_PAGE_SIZE);
+        usize huge_size = (size + huge_align - 1) & ~(usize)(huge_align - 1);
+        void* ptr = huge_size < size ? nullptr : aligned_alloc(huge_align, huge_size);
+        if (!ptr) return nullptr;
+        // where MADV_HUGEPAGE isnt there the pages just stay regular
+#ifdef MADV_HUGEPAGE
+        madvise(ptr, huge_size, MADV_HUGEPAGE);
+#endif // MADV_HUGEPAGE
+        return ptr;
+    }
+    if (align <= MRW_MALLOC_ALIGN) return malloc(size);
+    // c11 wants the size to be a multiple of the alignment
+    usize aligned_size = (size + align - 1) & ~(usize)(align - 1);
+    return aligned_size < size ? nullptr : aligned_alloc(align, aligned_size);
+}
+
+static inline void* _mrw_default_realloc(Allocator* allocator, void* ptr, usize old_size, usize new_size, usize align)
+{
+    if (!ptr) return _mrw_default_alloc(allocator, new_size, align);
+    if (!_mrw_default_is_huge(new_size) && align <= MRW_MALLOC_ALIGN) return realloc(ptr, new_size);
+
+    // huge blocks are rounded up to whole huge pages so growing within the last one is free
+    if (_mrw_default_is_huge(new_size)) {
+        if (_mrw_default_is_huge(old_size) && new_size <= ((old_size + MRW_HUGE_PAGE_SIZE - 1) & ~(usize)(MRW_HUGE_PAGE_SIZE - 1)))
+            return ptr;
+        void* new_ptr = _mrw_default_alloc(allocator, new_size, align);
+        if (!new_ptr) return nullptr;
+        buf_copy(new_ptr, ptr, min(old_size, new_size));
+        free(ptr);
+        return new_ptr;
+    }
+
+    // realloc might come back misaligned, in which case the data gets moved once more
+    void* new_ptr = realloc(ptr, new_size);
+    if (!new_ptr || ptr_align_up(new_ptr, align) == new_ptr) return new_ptr;
+    void* aligned_ptr = _mrw_default_alloc(allocator, new_size, align);
+    if (aligned_ptr) buf_copy(aligned_ptr, new_ptr, new_size);
+    free(new_ptr);
+    return aligned_ptr;
+}
+
 static inline void  _mrw_default_free(Allocator* allocator, void* ptr, usize size) { free(ptr); }
+#endif // _WIN32
 thread_local Allocator _mrw_default_allocator = {.alloc = &_mrw_default_alloc, .realloc = &_mrw_default_realloc, .free = &_mrw_default_free };
 
 static inline void* _mrw_alloc(Allocator* allocator, usize size, usize align) {
     void* ptr = (allocator ? allocator : &_mrw_default_allocator)->alloc(allocator, size, align);
+    _mrw_here_end();
     if (!ptr) mrw_abort("allocation failed !!!");
     return ptr;
 }
 static inline void* _mrw_realloc(Allocator* allocator, void* ptr, usize old_size, usize new_size, usize align) {
-    return (allocator ? allocator : &_mrw_default_allocator)->realloc(allocator, ptr, old_size, new_size, align);
+    void* new_ptr = (allocator ? allocator : &_mrw_default_allocator)->realloc(allocator, ptr, old_size, new_size, align);
+    _mrw_here_end();
+    return new_ptr;
 }
 static inline void _mrw_free(Allocator* allocator, void* ptr, usize size) {
-    if (!ptr) return;
-    (allocator ? allocator : &_mrw_default_allocator)->free(allocator, ptr, size);
+    if (ptr) (allocator ? allocator : &_mrw_default_allocator)->free(allocator, ptr, size);
+    _mrw_here_end();
 }
 static inline void* _mrw_alloc_copy(Allocator* allocator, void* ptr, usize size, usize align)
 {
@@ -55,7 +144,7 @@ static inline void* _mrw_alloc_copy(Allocator* allocator, void* ptr, usize size,
 
 static inline void* _mrw_fake_realloc(Allocator* allocator, void* ptr, usize old_size, usize new_size, usize align) {
     void* new_ptr = _mrw_alloc(allocator, new_size, align);
-    buf_copy(new_ptr, ptr, old_size);
+    buf_copy(new_ptr, ptr, min(old_size, new_size));
     return new_ptr;
 }
 
@@ -67,56 +156,1110 @@ typedef struct {
     usize capacity;
     usize used;
 } Arena;
-#define MRW_ARENA_IMPL ._impl = { .alloc = _mrw_arena_alloc, .realloc = _mrw_fake_realloc, .free = _mrw_fake_free }
+#define MRW_ARENA_IMPL ._impl = { .alloc = _mrw_arena_alloc, .realloc = _mrw_arena_realloc, .free = _mrw_fake_free }
 
 static inline void mrw_arena_reset(Arena* a) { a->used = 0; }
 
+// savepoints, everything allocated after the mark is released by the rewind
+static inline usize mrw_arena_mark(Arena* a) { return a->used; }
+static inline void mrw_arena_rewind(Arena* a, usize mark) { if (mark < a->used) a->used = mark; }
+
+// rewinds the arena when the block is left, breaking out of it skips the rewind
+#define mrw_arena_scope(a)\
+    for (usize LINE_UNIQUE_VAR(_arena_mark) = mrw_arena_mark((a)), LINE_UNIQUE_I = 0; !LINE_UNIQUE_I;\
+         LINE_UNIQUE_I++, mrw_arena_rewind((a), LINE_UNIQUE_VAR(_arena_mark)))
+
 static inline void* _mrw_arena_alloc(Allocator* allocator, usize size, usize align)
 {
     Arena* a = (Arena*)allocator;
-    if (a->used + size > a->capacity) mrw_abort("string allocator out of space");
-    void* p = (void*)(a->data + a->used);
-    a->used += size;
+    char* p = (char*)ptr_align_up(a->data + a->used, align ? align : 1);
+    usize new_used = (usize)(p - a->data) + size;
+    if (new_used < size || new_used > a->capacity) mrw_abort("arena out of space");
+    a->used = new_used;
     return p;
 }
 
+// grows (or shrinks) the last allocation in place, anything else gets copied
+static inline void* _mrw_arena_realloc(Allocator* allocator, void* ptr, usize old_size, usize new_size, usize align)
+{
+    Arena* a = (Arena*)allocator;
+    if (ptr && (char*)ptr + old_size == a->data + a->used) {
+        usize offset = (usize)((char*)ptr - a->data);
+        if (offset + new_size < offset || offset + new_size > a->capacity) mrw_abort("arena out of space");
+        a->used = offset + new_size;
+        return ptr;
+    }
+    return _mrw_fake_realloc(allocator, ptr, old_size, new_size, align);
+}
+
+// per thread scratch arenas, pass whatever allocator the results go into as
+// the conflict so the scratch you get back is never the one being returned into
+//
+// each one is a single MRW_SCRATCH_CAPACITY block allocated the first time the thread asks for it,
+// going past that aborts. the blocks stay around until mrw_scratch_release, a thread that exits
+// without calling it leaks them. thread pool workers from parallel.h release theirs on the way out
+#ifndef MRW_SCRATCH_CAPACITY
+#define MRW_SCRATCH_CAPACITY (8 * 1024 * 1024)
+#endif // MRW_SCRATCH_CAPACITY
+
+typedef struct {
+    Arena* arena;
+    usize mark;
+} ArenaScratch;
+
+thread_local Arena _mrw_scratch_arenas[2];
+
+static inline Arena* mrw_scratch_get(Allocator* conflict)
+{
+    for (u32 i = 0; i < array_len(_mrw_scratch_arenas); i++) {
+        Arena* a = &_mrw_scratch_arenas[i];
+        if ((Allocator*)a == conflict) continue;
+        if (!a->data)
+            *a = (Arena){ MRW_ARENA_IMPL, .data = _mrw_alloc(nullptr, MRW_SCRATCH_CAPACITY, 64), .capacity = MRW_SCRATCH_CAPACITY };
+        return a;
+    }
+    return nullptr;
+}
+
+// frees the calling threads scratch arenas, the next mrw_scratch_get allocates them again
+static inline void mrw_scratch_release(void)
+{
+    for (u32 i = 0; i < array_len(_mrw_scratch_arenas); i++) {
+        Arena* a = &_mrw_scratch_arenas[i];
+        if (a->data) _mrw_free(nullptr, a->data, a->capacity);
+        *a = (Arena){ 0 };
+    }
+}
+
+static inline ArenaScratch mrw_scratch_begin(Allocator* conflict)
+{
+    Arena* a = mrw_scratch_get(conflict);
+    return (ArenaScratch){ .arena = a, .mark = mrw_arena_mark(a) };
+}
+
+static inline void mrw_scratch_end(ArenaScratch scratch) { mrw_arena_rewind(scratch.arena, scratch.mark); }
+
+#define mrw_scratch_scope(name, conflict)\
+    for (ArenaScratch name = mrw_scratch_begin((conflict)); name.arena; mrw_scratch_end(name), name.arena = nullptr)
+
+// one buffer with two ends, _impl allocates upwards from the bottom (long lived stuff) and
+// mrw_stack_temp() downwards from the top (temporaries). frees in LIFO order give the memory back,
+// every allocation keeps the cursor from before it in a usize next to it so the alignment padding
+// comes back too
+typedef struct {
+    Allocator _impl;
+    Allocator _temp_impl;
+    u8* data;
+    usize capacity;
+    usize bottom; // bytes used from the bottom
+    usize top;    // bytes used from the top
+} StackAllocator;
+#define MRW_STACK_IMPL \
+    ._impl = { .alloc = _mrw_stack_alloc, .realloc = _mrw_stack_realloc, .free = _mrw_stack_free }, \
+    ._temp_impl = { .alloc = _mrw_stack_temp_alloc, .realloc = _mrw_stack_temp_realloc, .free = _mrw_stack_temp_free }
+
+#define mrw_stack_temp(s) (&(s)->_temp_impl)
+
+static inline void mrw_stack_reset(StackAllocator* s) { s->bottom = s->top = 0; }
+
+static inline usize mrw_stack_mark(StackAllocator* s) { return s->bottom; }
+static inline void mrw_stack_rewind(StackAllocator* s, usize mark) { if (mark < s->bottom) s->bottom = mark; }
+static inline usize mrw_stack_temp_mark(StackAllocator* s) { return s->top; }
+static inline void mrw_stack_temp_rewind(StackAllocator* s, usize mark) { if (mark < s->top) s->top = mark; }
+
+#define mrw_stack_temp_scope(s)\
+    for (usize LINE_UNIQUE_VAR(_stack_mark) = mrw_stack_temp_mark((s)), LINE_UNIQUE_I = 0; !LINE_UNIQUE_I;\
+         LINE_UNIQUE_I++, mrw_stack_temp_rewind((s), LINE_UNIQUE_VAR(_stack_mark)))
+
+// the previous bottom sits right below the allocation
+static inline void* _mrw_stack_alloc(Allocator* allocator, usize size, usize align)
+{
+    StackAllocator* s = (StackAllocator*)allocator;
+    u8* p = (u8*)ptr_align_up(s->data + s->bottom + sizeof(usize), align ? align : 1);
+    usize new_bottom = (usize)(p - s->data) + size;
+    if (new_bottom < size || new_bottom + s->top > s->capacity) mrw_abort("stack allocator out of space");
+    buf_copy(p - sizeof(usize), &s->bottom, sizeof(usize));
+    s->bottom = new_bottom;
+    return p;
+}
+
+static inline void _mrw_stack_free(Allocator* allocator, void* ptr, usize size)
+{
+    StackAllocator* s = (StackAllocator*)allocator;
+    if ((u8*)ptr + size == s->data + s->bottom) buf_copy(&s->bottom, (u8*)ptr - sizeof(usize), sizeof(usize));
+}
+
+static inline void* _mrw_stack_realloc(Allocator* allocator, void* ptr, usize old_size, usize new_size, usize align)
+{
+    StackAllocator* s = (StackAllocator*)allocator;
+    if (ptr && (u8*)ptr + old_size == s->data + s->bottom) {
+        usize offset = (usize)((u8*)ptr - s->data);
+        if (offset + new_size < offset || offset + new_size + s->top > s->capacity) mrw_abort("stack allocator out of space");
+        s->bottom = offset + new_size;
+        return ptr;
+    }
+    return _mrw_fake_realloc(allocator, ptr, old_size, new_size, align);
+}
+
+static inline StackAllocator* _mrw_stack_from_temp(Allocator* allocator) { return (StackAllocator*)((u8*)allocator - offsetof(StackAllocator, _temp_impl)); }
+
+// where a size byte temp allocation starts below the current top, the previous top goes right above it
+static inline usize _mrw_stack_temp_start(StackAllocator* s, usize size, usize align)
+{
+    usize end = s->capacity - s->top;
+    if (size + sizeof(usize) < size || size + sizeof(usize) > end - s->bottom) mrw_abort("stack allocator out of space");
+    usize start = ((usize)(s->data + end - sizeof(usize) - size) & ~(usize)((align ? align : 1) - 1)) - (usize)s->data;
+    if (start > end || start < s->bottom) mrw_abort("stack allocator out of space");
+    return start;
+}
+
+static inline void* _mrw_stack_temp_alloc(Allocator* allocator, usize size, usize align)
+{
+    StackAllocator* s = _mrw_stack_from_temp(allocator);
+    usize start = _mrw_stack_temp_start(s, size, align);
+    buf_copy(s->data + start + size, &s->top, sizeof(usize));
+    s->top = s->capacity - start;
+    return s->data + start;
+}
+
+static inline void _mrw_stack_temp_free(Allocator* allocator, void* ptr, usize size)
+{
+    StackAllocator* s = _mrw_stack_from_temp(allocator);
+    if ((u8*)ptr == s->data + s->capacity - s->top) buf_copy(&s->top, (u8*)ptr + size, sizeof(usize));
+}
+
+// the top allocation grows downwards so its data slides down to make room
+static inline void* _mrw_stack_temp_realloc(Allocator* allocator, void* ptr, usize old_size, usize new_size, usize align)
+{
+    StackAllocator* s = _mrw_stack_from_temp(allocator);
+    if (ptr && (u8*)ptr == s->data + s->capacity - s->top) {
+        usize previous_top;
+        buf_copy(&previous_top, (u8*)ptr + old_size, sizeof(usize));
+        s->top = previous_top;
+        usize start = _mrw_stack_temp_start(s, new_size, align);
+        buf_move(s->data + start, ptr, min(old_size, new_size));
+        buf_copy(s->data + start + new_size, &previous_top, sizeof(usize));
+        s->top = s->capacity - start;
+        return s->data + start;
+    }
+    return _mrw_fake_realloc(allocator, ptr, old_size, new_size, align);
+}
+
 typedef struct BumpAllocatorBlock {
     struct BumpAllocatorBlock* next;
     usize capacity, used;
     u8 data[];
 } BumpAllocatorBlock;
 
+// blocks are kept oldest to newest, allocations only ever bump `current`
 typedef struct {
     Allocator _impl;
     BumpAllocatorBlock* first;
+    BumpAllocatorBlock* current;
     Allocator* allocator;
+    bool consolidate; // on reset replace all the blocks with one sized to the peak
+
+    // stats, updated on reset
+    usize n_blocks;
+    usize peak;   // most bytes used between two resets
+    usize wasted; // total bytes left at the end of blocks that didnt fit the next allocation
 } BumpAllocator;
-#define MRW_BUMP_IMPL ._impl = { .alloc = _mrw_bump_alloc, .realloc = _mrw_fake_realloc, .free = _mrw_fake_free }
+#define MRW_BUMP_IMPL ._impl = { .alloc = _mrw_bump_alloc, .realloc = _mrw_bump_realloc, .free = _mrw_fake_free }
+
+static inline void mrw_bump_free(BumpAllocator* a)
+{
+    BumpAllocatorBlock* b = a->first;
+    while (b) {
+        BumpAllocatorBlock* next = b->next;
+        _mrw_free(a->allocator, b, sizeof(BumpAllocatorBlock) + b->capacity);
+        b = next;
+    }
+    a->first = a->current = nullptr;
+    a->n_blocks = 0;
+}
+
+static inline bool _mrw_bump_fits(BumpAllocatorBlock* b, usize size, usize align)
+{
+    usize offset = (usize)((u8*)ptr_align_up(b->data + b->used, align) - b->data);
+    return offset + size >= offset && offset + size <= b->capacity;
+}
 
-static inline void mrw_bump_reset(BumpAllocator* a) {
-    for (BumpAllocatorBlock* b = a->first; b; b = b->next) b->used = 0;
+// moves current to the next block that fits, appends a new one if none do
+static inline void _mrw_bump_next_block(BumpAllocator* a, usize size, usize align)
+{
+    BumpAllocatorBlock* last = a->current ? a->current : a->first;
+    while (last && last->next) {
+        last = last->next;
+        if (_mrw_bump_fits(last, size, align)) {
+            a->current = last;
+            return;
+        }
+    }
+
+    if (size + align < size) mrw_abort("uhh");
+    usize capacity = max(last ? (last->capacity + last->capacity / 2) : 1024, size + align);
+    BumpAllocatorBlock* b = (BumpAllocatorBlock*)_mrw_alloc(a->allocator, sizeof(BumpAllocatorBlock) + capacity, alignof(BumpAllocatorBlock));
+    *b = (BumpAllocatorBlock){ .capacity = capacity };
+    if (last) last->next = b;
+    else a->first = b;
+    a->current = b;
+    a->n_blocks++;
+}
+
+static inline void mrw_bump_reset(BumpAllocator* a)
+{
+    // blocks after current are untouched since the last reset
+    usize used = 0;
+    for (BumpAllocatorBlock* b = a->first; b; b = b->next) {
+        bool is_current = b == a->current;
+        used += b->used;
+        if (!is_current) a->wasted += b->capacity - b->used;
+        b->used = 0;
+        if (is_current) break;
+    }
+    a->peak = max(a->peak, used);
+
+    if (a->consolidate && a->n_blocks > 1) {
+        mrw_bump_free(a);
+        _mrw_bump_next_block(a, a->peak, 1);
+    }
+    a->current = a->first;
 }
 
 static inline void* _mrw_bump_alloc(Allocator* allocator, usize size, usize align)
 {
     BumpAllocator* a = (BumpAllocator*)allocator;
-    loop {
-        for (BumpAllocatorBlock* b = a->first; b; b = b->next) {
-            u8* ptr = b->data + b->used;
-            u8* aligned_ptr = (u8*)ptr_align_up(ptr, align);
-            usize new_used = (usize)(aligned_ptr - b->data) + size;
-            if (new_used <= b->capacity) {
-                b->used = new_used;
-                return aligned_ptr;
-            }
+    align = align ? align : 1;
+    BumpAllocatorBlock* b = a->current;
+    if (!b || !_mrw_bump_fits(b, size, align)) {
+        _mrw_bump_next_block(a, size, align);
+        b = a->current;
+    }
+    u8* aligned_ptr = (u8*)ptr_align_up(b->data + b->used, align);
+    b->used = (usize)(aligned_ptr - b->data) + size;
+    return aligned_ptr;
+}
+
+// grows the last allocation in place, if it doesnt fit the data gets moved to
+// a block with room to keep growing and the old tail is handed back
+static inline void* _mrw_bump_realloc(Allocator* allocator, void* ptr, usize old_size, usize new_size, usize align)
+{
+    BumpAllocator* a = (BumpAllocator*)allocator;
+    BumpAllocatorBlock* b = a->current;
+    if (!ptr || !b || (u8*)ptr + old_size != b->data + b->used)
+        return _mrw_fake_realloc(allocator, ptr, old_size, new_size, align);
+
+    usize offset = (usize)((u8*)ptr - b->data);
+    if (offset + new_size >= offset && offset + new_size <= b->capacity) {
+        b->used = offset + new_size;
+        return ptr;
+    }
+
+    if (new_size * 2 < new_size) mrw_abort("uhh");
+    _mrw_bump_next_block(a, new_size * 2, align ? align : 1);
+    void* new_ptr = _mrw_fake_realloc(allocator, ptr, old_size, new_size, align);
+    b->used = offset;
+    return new_ptr;
+}
+
+// size classes go 8, 16, .. 64 and then 4 steps per power of two (1.25x, 1.5x, 1.75x, 2x)
+// up to MRW_SLAB_MAX_SIZE, anything bigger goes straight to the backing allocator.
+// frees are sized so objects have no header, slabs are never handed back until mrw_slab_free
+#define MRW_SLAB_MAX_SIZE 4096
+#define MRW_SLAB_N_CLASSES 32
+
+#ifndef MRW_SLAB_PAGE_SIZE
+#define MRW_SLAB_PAGE_SIZE 4096
+#endif // MRW_SLAB_PAGE_SIZE
+
+typedef struct SlabAllocatorSlab {
+    struct SlabAllocatorSlab* next;
+    usize size;
+} SlabAllocatorSlab;
+
+typedef struct {
+    Allocator _impl;
+    Allocator* allocator; // where slabs and big allocations come from
+    SlabAllocatorSlab* slabs;
+    struct { void* free; u8* cursor; u8* end; } classes[MRW_SLAB_N_CLASSES];
+} SlabAllocator;
+#define MRW_SLAB_IMPL ._impl = { .alloc = _mrw_slab_alloc, .realloc = _mrw_slab_realloc, .free = _mrw_slab_free }
+
+static inline u32 _mrw_slab_class(usize size)
+{
+    if (size <= 64) return size ? (u32)((size + 7) / 8) - 1 : 0;
+    u32 e = u64_log2(size - 1);
+    return 8 + (e - 6) * 4 + (u32)((size - 1 - (1ULL << e)) >> (e - 2));
+}
+
+static inline usize _mrw_slab_class_size(u32 c)
+{
+    if (c < 8) return (c + 1) * 8;
+    u32 e = (c - 8) / 4 + 6;
+    return (1ULL << e) + ((c - 8) % 4 + 1) * (1ULL << (e - 2));
+}
+
+// objects are aligned to the largest power of two dividing their class size
+static inline usize _mrw_slab_class_align(u32 c)
+{
+    usize class_size = _mrw_slab_class_size(c);
+    return min(class_size & (~class_size + 1), MRW_SLAB_PAGE_SIZE);
+}
+
+// stricter alignment bumps the allocation to a power of two class. the sized free then recycles it
+// into the (smaller or equal) class its size maps to, a power of two object is at least as aligned
+// as any smaller class so thats fine
+static inline u32 _mrw_slab_class_aligned(usize size, usize align)
+{
+    u32 c = _mrw_slab_class(size);
+    if (align <= _mrw_slab_class_align(c)) return c;
+    return _mrw_slab_class(max(u64_nextpow2(size - 1), align));
+}
+
+// a realloc can only keep the object if it fits, meets align and, since the sized free will put it
+// into the class of new_size, meets that classes alignment too. shrinking a 112 byte object (16
+// aligned) to 96 bytes would otherwise hand it out later as a 32 aligned one
+static inline bool _mrw_slab_realloc_in_place(void* ptr, usize old_size, usize new_size, usize align)
+{
+    if (old_size > MRW_SLAB_MAX_SIZE || new_size > MRW_SLAB_MAX_SIZE) return false;
+    u32 old_c = _mrw_slab_class(old_size), new_c = _mrw_slab_class(new_size);
+    if (new_size > _mrw_slab_class_size(old_c)) return false;
+    usize need = max(align ? align : 1, new_c == old_c ? 1 : _mrw_slab_class_align(new_c));
+    return ((usize)ptr & (need - 1)) == 0;
+}
+
+static inline void mrw_slab_free(SlabAllocator* a)
+{
+    SlabAllocatorSlab* s = a->slabs;
+    while (s) {
+        SlabAllocatorSlab* next = s->next;
+        _mrw_free(a->allocator, s, s->size);
+        s = next;
+    }
+    *a = (SlabAllocator){ ._impl = a->_impl, .allocator = a->allocator };
+}
+
+static inline void* _mrw_slab_alloc(Allocator* allocator, usize size, usize align)
+{
+    SlabAllocator* a = (SlabAllocator*)allocator;
+    align = align ? align : 1;
+    if (size > MRW_SLAB_MAX_SIZE) return _mrw_alloc(a->allocator, size, align);
+    // the sized free would push it onto a slab list instead of handing it back
+    if (align > MRW_SLAB_MAX_SIZE) mrw_abort("slab allocator cant align small objects past MRW_SLAB_MAX_SIZE");
+
+    u32 c = _mrw_slab_class_aligned(size, align);
+    usize class_size = _mrw_slab_class_size(c);
+
+    void* p = a->classes[c].free;
+    if (p) {
+        a->classes[c].free = *(void**)p;
+        return p;
+    }
+
+    if ((usize)(a->classes[c].end - a->classes[c].cursor) < class_size) {
+        usize object_align = _mrw_slab_class_align(c);
+        usize objects_size = max(MRW_SLAB_PAGE_SIZE, class_size * 8) / class_size * class_size;
+        usize slab_size = sizeof(SlabAllocatorSlab) + object_align + objects_size;
+        SlabAllocatorSlab* s = (SlabAllocatorSlab*)_mrw_alloc(a->allocator, slab_size, alignof(SlabAllocatorSlab));
+        *s = (SlabAllocatorSlab){ .next = a->slabs, .size = slab_size };
+        a->slabs = s;
+        a->classes[c].cursor = (u8*)ptr_align_up(s + 1, object_align);
+        a->classes[c].end = a->classes[c].cursor + objects_size;
+    }
+
+    p = a->classes[c].cursor;
+    a->classes[c].cursor += class_size;
+    return p;
+}
+
+static inline void _mrw_slab_free(Allocator* allocator, void* ptr, usize size)
+{
+    SlabAllocator* a = (SlabAllocator*)allocator;
+    if (size > MRW_SLAB_MAX_SIZE) {
+        _mrw_free(a->allocator, ptr, size);
+        return;
+    }
+    u32 c = _mrw_slab_class(size);
+    *(void**)ptr = a->classes[c].free;
+    a->classes[c].free = ptr;
+}
+
+static inline void* _mrw_slab_realloc(Allocator* allocator, void* ptr, usize old_size, usize new_size, usize align)
+{
+    SlabAllocator* a = (SlabAllocator*)allocator;
+    if (!ptr) return _mrw_slab_alloc(allocator, new_size, align);
+    if (old_size > MRW_SLAB_MAX_SIZE && new_size > MRW_SLAB_MAX_SIZE)
+        return _mrw_realloc(a->allocator, ptr, old_size, new_size, align);
+    if (_mrw_slab_realloc_in_place(ptr, old_size, new_size, align))
+        return ptr;
+
+    void* new_ptr = _mrw_slab_alloc(allocator, new_size, align);
+    buf_copy(new_ptr, ptr, min(old_size, new_size));
+    _mrw_slab_free(allocator, ptr, old_size);
+    return new_ptr;
+}
+
+// two level segregated fit, O(1) alloc/free/realloc with real frees over a set of regions.
+// blocks carry one usize of header, the first level is the power of two of the size and the
+// second level splits it into MRW_TLSF_SL_COUNT linear steps, bitmaps find a fitting list
+#define MRW_TLSF_SL_LOG2 5
+#define MRW_TLSF_SL_COUNT (1 << MRW_TLSF_SL_LOG2)
+#define MRW_TLSF_ALIGN_LOG2 3
+#define MRW_TLSF_ALIGN (1 << MRW_TLSF_ALIGN_LOG2)
+#define MRW_TLSF_FL_SHIFT (MRW_TLSF_SL_LOG2 + MRW_TLSF_ALIGN_LOG2)
+#define MRW_TLSF_FL_MAX 39
+#define MRW_TLSF_FL_COUNT (MRW_TLSF_FL_MAX - MRW_TLSF_FL_SHIFT + 1)
+#define MRW_TLSF_SMALL_BLOCK (1 << MRW_TLSF_FL_SHIFT)
+
+#ifndef MRW_TLSF_REGION_SIZE
+#define MRW_TLSF_REGION_SIZE (1024 * 1024)
+#endif // MRW_TLSF_REGION_SIZE
+
+#define _MRW_TLSF_FREE 1
+#define _MRW_TLSF_PREV_FREE 2
+#define _MRW_TLSF_OVERHEAD sizeof(usize)
+#define _MRW_TLSF_MIN_BLOCK (sizeof(TlsfBlock) - sizeof(TlsfBlock*))
+#define _MRW_TLSF_MAX_BLOCK ((usize)1 << MRW_TLSF_FL_MAX)
+
+// prev_phys lives in the last word of the previous block and is only valid while that one is free,
+// next_free/prev_free are only valid while this one is free and are where the user data starts otherwise
+typedef struct TlsfBlock {
+    struct TlsfBlock* prev_phys;
+    usize size;
+    struct TlsfBlock* next_free;
+    struct TlsfBlock* prev_free;
+} TlsfBlock;
+
+typedef struct TlsfRegion {
+    struct TlsfRegion* next;
+    usize size;
+} TlsfRegion;
+
+typedef struct {
+    Allocator _impl;
+    Allocator* allocator; // where new regions come from
+    usize region_size;    // 0 -> MRW_TLSF_REGION_SIZE
+    bool fixed;           // only use regions added with mrw_tlsf_add_region
+
+    u32 fl_bitmap;
+    u32 sl_bitmap[MRW_TLSF_FL_COUNT];
+    TlsfBlock* blocks[MRW_TLSF_FL_COUNT][MRW_TLSF_SL_COUNT];
+    TlsfRegion* regions;
+
+    // stats
+    usize total;
+    usize free;
+} TlsfAllocator;
+#define MRW_TLSF_IMPL ._impl = { .alloc = _mrw_tlsf_alloc, .realloc = _mrw_tlsf_realloc, .free = _mrw_tlsf_free }
+
+static inline usize _tlsf_size(TlsfBlock* b) { return b->size & ~(usize)(_MRW_TLSF_FREE | _MRW_TLSF_PREV_FREE); }
+static inline void _tlsf_set_size(TlsfBlock* b, usize size) { b->size = size | (b->size & (_MRW_TLSF_FREE | _MRW_TLSF_PREV_FREE)); }
+static inline void* _tlsf_to_ptr(TlsfBlock* b) { return (u8*)b + offsetof(TlsfBlock, next_free); }
+static inline TlsfBlock* _tlsf_from_ptr(void* p) { return (TlsfBlock*)((u8*)p - offsetof(TlsfBlock, next_free)); }
+static inline TlsfBlock* _tlsf_next(TlsfBlock* b) { return (TlsfBlock*)((u8*)_tlsf_to_ptr(b) + _tlsf_size(b) - _MRW_TLSF_OVERHEAD); }
+
+static inline TlsfBlock* _tlsf_link_next(TlsfBlock* b)
+{
+    TlsfBlock* next = _tlsf_next(b);
+    next->prev_phys = b;
+    return next;
+}
+
+static inline void _tlsf_mark_free(TlsfBlock* b)
+{
+    _tlsf_link_next(b)->size |= _MRW_TLSF_PREV_FREE;
+    b->size |= _MRW_TLSF_FREE;
+}
+
+static inline void _tlsf_mark_used(TlsfBlock* b)
+{
+    _tlsf_next(b)->size &= ~(usize)_MRW_TLSF_PREV_FREE;
+    b->size &= ~(usize)_MRW_TLSF_FREE;
+}
+
+static inline void _tlsf_mapping(usize size, u32* fl, u32* sl)
+{
+    if (size < MRW_TLSF_SMALL_BLOCK) {
+        *fl = 0;
+        *sl = (u32)size / (MRW_TLSF_SMALL_BLOCK / MRW_TLSF_SL_COUNT);
+        return;
+    }
+    u32 f = u64_log2(size);
+    *sl = (u32)(size >> (f - MRW_TLSF_SL_LOG2)) ^ MRW_TLSF_SL_COUNT;
+    *fl = f - (MRW_TLSF_FL_SHIFT - 1);
+}
+
+// rounds up to the next list so any block in it fits
+static inline void _tlsf_mapping_search(usize size, u32* fl, u32* sl)
+{
+    if (size >= MRW_TLSF_SMALL_BLOCK) size += ((usize)1 << (u64_log2(size) - MRW_TLSF_SL_LOG2)) - 1;
+    _tlsf_mapping(size, fl, sl);
+}
+
+static inline void _tlsf_remove_free(TlsfAllocator* a, TlsfBlock* b, u32 fl, u32 sl)
+{
+    TlsfBlock* prev = b->prev_free;
+    TlsfBlock* next = b->next_free;
+    if (next) next->prev_free = prev;
+    if (prev) prev->next_free = next;
+    else {
+        a->blocks[fl][sl] = next;
+        if (!next) {
+            a->sl_bitmap[fl] &= ~(1u << sl);
+            if (!a->sl_bitmap[fl]) a->fl_bitmap &= ~(1u << fl);
+        }
+    }
+    a->free -= _tlsf_size(b);
+}
+
+static inline void _tlsf_insert_free(TlsfAllocator* a, TlsfBlock* b, u32 fl, u32 sl)
+{
+    TlsfBlock* current = a->blocks[fl][sl];
+    b->next_free = current;
+    b->prev_free = nullptr;
+    if (current) current->prev_free = b;
+    a->blocks[fl][sl] = b;
+    a->fl_bitmap |= 1u << fl;
+    a->sl_bitmap[fl] |= 1u << sl;
+    a->free += _tlsf_size(b);
+}
+
+static inline void _tlsf_remove(TlsfAllocator* a, TlsfBlock* b)
+{
+    u32 fl, sl;
+    _tlsf_mapping(_tlsf_size(b), &fl, &sl);
+    _tlsf_remove_free(a, b, fl, sl);
+}
+
+static inline void _tlsf_insert(TlsfAllocator* a, TlsfBlock* b)
+{
+    u32 fl, sl;
+    _tlsf_mapping(_tlsf_size(b), &fl, &sl);
+    _tlsf_insert_free(a, b, fl, sl);
+}
+
+static inline bool _tlsf_can_split(TlsfBlock* b, usize size) { return _tlsf_size(b) >= sizeof(TlsfBlock) + size; }
+
+// cuts b down to size and returns the (flagless) remainder
+static inline TlsfBlock* _tlsf_split(TlsfBlock* b, usize size)
+{
+    TlsfBlock* remaining = (TlsfBlock*)((u8*)_tlsf_to_ptr(b) + size - _MRW_TLSF_OVERHEAD);
+    remaining->size = _tlsf_size(b) - (size + _MRW_TLSF_OVERHEAD);
+    _tlsf_set_size(b, size);
+    _tlsf_mark_free(remaining);
+    return remaining;
+}
+
+static inline TlsfBlock* _tlsf_absorb(TlsfBlock* prev, TlsfBlock* b)
+{
+    prev->size += _tlsf_size(b) + _MRW_TLSF_OVERHEAD;
+    _tlsf_link_next(prev);
+    return prev;
+}
+
+static inline TlsfBlock* _tlsf_merge_prev(TlsfAllocator* a, TlsfBlock* b)
+{
+    if (!(b->size & _MRW_TLSF_PREV_FREE)) return b;
+    TlsfBlock* prev = b->prev_phys;
+    _tlsf_remove(a, prev);
+    return _tlsf_absorb(prev, b);
+}
+
+static inline TlsfBlock* _tlsf_merge_next(TlsfAllocator* a, TlsfBlock* b)
+{
+    TlsfBlock* next = _tlsf_next(b);
+    if (!(next->size & _MRW_TLSF_FREE)) return b;
+    _tlsf_remove(a, next);
+    return _tlsf_absorb(b, next);
+}
+
+static inline void _tlsf_trim_free(TlsfAllocator* a, TlsfBlock* b, usize size)
+{
+    if (!_tlsf_can_split(b, size)) return;
+    TlsfBlock* remaining = _tlsf_split(b, size);
+    _tlsf_link_next(b);
+    remaining->size |= _MRW_TLSF_PREV_FREE;
+    _tlsf_insert(a, remaining);
+}
+
+static inline void _tlsf_trim_used(TlsfAllocator* a, TlsfBlock* b, usize size)
+{
+    if (!_tlsf_can_split(b, size)) return;
+    TlsfBlock* remaining = _tlsf_split(b, size);
+    remaining->size &= ~(usize)_MRW_TLSF_PREV_FREE;
+    remaining = _tlsf_merge_next(a, remaining);
+    _tlsf_insert(a, remaining);
+}
+
+// frees the first size bytes of b and returns what comes after
+static inline TlsfBlock* _tlsf_trim_free_leading(TlsfAllocator* a, TlsfBlock* b, usize size)
+{
+    if (!_tlsf_can_split(b, size)) return b;
+    TlsfBlock* remaining = _tlsf_split(b, size - _MRW_TLSF_OVERHEAD);
+    remaining->size |= _MRW_TLSF_PREV_FREE;
+    _tlsf_link_next(b);
+    _tlsf_insert(a, b);
+    return remaining;
+}
+
+static inline TlsfBlock* _tlsf_locate_free(TlsfAllocator* a, usize size)
+{
+    u32 fl, sl;
+    _tlsf_mapping_search(size, &fl, &sl);
+    if (fl >= MRW_TLSF_FL_COUNT) return nullptr;
+
+    u32 sl_map = a->sl_bitmap[fl] & (~0u << sl);
+    if (!sl_map) {
+        u32 fl_map = fl + 1 < 32 ? a->fl_bitmap & (~0u << (fl + 1)) : 0;
+        if (!fl_map) return nullptr;
+        fl = u64_ctz(fl_map);
+        sl_map = a->sl_bitmap[fl];
+    }
+    sl = u64_ctz(sl_map);
+
+    TlsfBlock* b = a->blocks[fl][sl];
+    _tlsf_remove_free(a, b, fl, sl);
+    return b;
+}
+
+static inline usize _tlsf_adjust_request(usize size)
+{
+    usize aligned = (size + (MRW_TLSF_ALIGN - 1)) & ~(usize)(MRW_TLSF_ALIGN - 1);
+    if (aligned < size || aligned >= _MRW_TLSF_MAX_BLOCK) return 0;
+    return max(aligned, _MRW_TLSF_MIN_BLOCK);
+}
+
+// hands a chunk of memory over to the allocator, it has to outlive it
+static inline void mrw_tlsf_add_region(TlsfAllocator* a, void* mem, usize size)
+{
+    u8* start = (u8*)ptr_align_up(mem, MRW_TLSF_ALIGN);
+    if ((usize)(start - (u8*)mem) + 2 * _MRW_TLSF_OVERHEAD + _MRW_TLSF_MIN_BLOCK > size) return;
+    usize usable = (size - (usize)(start - (u8*)mem) - 2 * _MRW_TLSF_OVERHEAD) & ~(usize)(MRW_TLSF_ALIGN - 1);
+    usable = min(usable, _MRW_TLSF_MAX_BLOCK - MRW_TLSF_ALIGN);
+
+    // the first block hangs one word off the front of the region, its prev_phys is never touched
+    TlsfBlock* b = (TlsfBlock*)(start - _MRW_TLSF_OVERHEAD);
+    b->size = usable | _MRW_TLSF_FREE;
+    _tlsf_insert(a, b);
+
+    // zero sized used sentinel that stops merging past the end
+    TlsfBlock* sentinel = _tlsf_link_next(b);
+    sentinel->size = _MRW_TLSF_PREV_FREE;
+
+    a->total += usable;
+}
+
+static inline bool _tlsf_grow(TlsfAllocator* a, usize size)
+{
+    if (a->fixed) return false;
+    usize needed = size + (size >> MRW_TLSF_SL_LOG2) + sizeof(TlsfRegion) + sizeof(TlsfBlock) + 4 * _MRW_TLSF_OVERHEAD;
+    if (needed < size) return false;
+    usize region_size = max(a->region_size ? a->region_size : MRW_TLSF_REGION_SIZE, needed);
+    TlsfRegion* r = (TlsfRegion*)_mrw_alloc(a->allocator, region_size, alignof(TlsfRegion));
+    *r = (TlsfRegion){ .next = a->regions, .size = region_size };
+    a->regions = r;
+    mrw_tlsf_add_region(a, r + 1, region_size - sizeof(TlsfRegion));
+    return true;
+}
+
+static inline void* _mrw_tlsf_alloc(Allocator* allocator, usize size, usize align)
+{
+    TlsfAllocator* a = (TlsfAllocator*)allocator;
+    usize adjusted = _tlsf_adjust_request(size);
+    if (!adjusted) return nullptr;
+
+    // over aligned requests grab enough to fit a free block in front of the aligned pointer
+    usize gap_min = sizeof(TlsfBlock);
+    usize search = adjusted;
+    if (align > MRW_TLSF_ALIGN) {
+        search = _tlsf_adjust_request(adjusted + align + gap_min);
+        if (!search) return nullptr;
+    }
+
+    TlsfBlock* b = _tlsf_locate_free(a, search);
+    if (!b && _tlsf_grow(a, search + align)) b = _tlsf_locate_free(a, search);
+    if (!b) return nullptr;
+
+    if (align > MRW_TLSF_ALIGN) {
+        u8* ptr = (u8*)_tlsf_to_ptr(b);
+        u8* aligned = (u8*)ptr_align_up(ptr, align);
+        usize gap = (usize)(aligned - ptr);
+        if (gap && gap < gap_min) {
+            aligned = (u8*)ptr_align_up(aligned + max(gap_min - gap, align), align);
+            gap = (usize)(aligned - ptr);
+        }
+        if (gap) b = _tlsf_trim_free_leading(a, b, gap);
+    }
+
+    _tlsf_trim_free(a, b, adjusted);
+    _tlsf_mark_used(b);
+    return _tlsf_to_ptr(b);
+}
+
+static inline void _mrw_tlsf_free(Allocator* allocator, void* ptr, usize size)
+{
+    TlsfAllocator* a = (TlsfAllocator*)allocator;
+    TlsfBlock* b = _tlsf_from_ptr(ptr);
+    _tlsf_mark_free(b);
+    b = _tlsf_merge_prev(a, b);
+    b = _tlsf_merge_next(a, b);
+    _tlsf_insert(a, b);
+}
+
+static inline void* _mrw_tlsf_realloc(Allocator* allocator, void* ptr, usize old_size, usize new_size, usize align)
+{
+    TlsfAllocator* a = (TlsfAllocator*)allocator;
+    if (!ptr) return _mrw_tlsf_alloc(allocator, new_size, align);
+
+    TlsfBlock* b = _tlsf_from_ptr(ptr);
+    TlsfBlock* next = _tlsf_next(b);
+    usize current = _tlsf_size(b);
+    usize combined = current + _tlsf_size(next) + _MRW_TLSF_OVERHEAD;
+    usize adjusted = _tlsf_adjust_request(new_size);
+    if (!adjusted) return nullptr;
+
+    if (adjusted > current && (!(next->size & _MRW_TLSF_FREE) || adjusted > combined)) {
+        void* new_ptr = _mrw_tlsf_alloc(allocator, new_size, align);
+        if (!new_ptr) return nullptr;
+        buf_copy(new_ptr, ptr, min(current, new_size));
+        _mrw_tlsf_free(allocator, ptr, old_size);
+        return new_ptr;
+    }
+
+    if (adjusted > current) {
+        _tlsf_merge_next(a, b);
+        _tlsf_mark_used(b);
+    }
+    _tlsf_trim_used(a, b, adjusted);
+    return ptr;
+}
+
+typedef struct {
+    usize total;        // bytes handed to the allocator by its regions
+    usize used;         // bytes in used blocks including their headers
+    usize free;
+    usize largest_free;
+    f32 fragmentation;  // 1 - largest_free / free
+} TlsfStats;
+
+static inline TlsfStats mrw_tlsf_stats(TlsfAllocator* a)
+{
+    TlsfStats stats = { .total = a->total, .used = a->total - a->free, .free = a->free };
+    if (a->fl_bitmap) {
+        u32 fl = u64_log2(a->fl_bitmap);
+        u32 sl = u64_log2(a->sl_bitmap[fl]);
+        for (TlsfBlock* b = a->blocks[fl][sl]; b; b = b->next_free)
+            stats.largest_free = max(stats.largest_free, _tlsf_size(b));
+    }
+    stats.fragmentation = stats.free ? 1.0f - (f32)stats.largest_free / (f32)stats.free : 0.0f;
+    return stats;
+}
+
+// releases the regions the allocator grew by itself, added regions are left to their owner
+static inline void mrw_tlsf_free(TlsfAllocator* a)
+{
+    TlsfRegion* r = a->regions;
+    while (r) {
+        TlsfRegion* next = r->next;
+        _mrw_free(a->allocator, r, r->size);
+        r = next;
+    }
+    *a = (TlsfAllocator){ ._impl = a->_impl, .allocator = a->allocator, .region_size = a->region_size, .fixed = a->fixed };
+}
+
+// thread caching allocator, each thread keeps two magazines of blocks per size class (same classes
+// as SlabAllocator) and only touches the shared depot when both are empty or both are full.
+// blocks arent owned by threads, a block freed on another thread lands in that threads magazine
+// and flows back through the depot, so remote frees cost the same as local ones.
+// threads should call mrw_caching_thread_flush before exiting or their cached blocks are lost.
+// a thread caches for up to MRW_CACHING_MAX_INSTANCES allocators at once, using one more flushes
+// the cache of another one back to its depot
+#ifndef MRW_CACHING_MAGAZINE_SIZE
+#define MRW_CACHING_MAGAZINE_SIZE 64
+#endif // MRW_CACHING_MAGAZINE_SIZE
+
+#ifndef MRW_CACHING_MAX_INSTANCES
+#define MRW_CACHING_MAX_INSTANCES 4
+#endif // MRW_CACHING_MAX_INSTANCES
+
+typedef struct CachingMagazine {
+    struct CachingMagazine* next;
+    struct CachingMagazine* all_next;
+    u32 count;
+    void* items[MRW_CACHING_MAGAZINE_SIZE];
+} CachingMagazine;
+
+typedef struct CachingChunk {
+    struct CachingChunk* next;
+    usize size;
+} CachingChunk;
+
+typedef struct CachingAllocator {
+    Allocator _impl;
+    Allocator* allocator; // where blocks come from, has to be thread safe
+
+    atomic_flag _lock;
+    struct { CachingMagazine* full; CachingMagazine* empty; } _depot[MRW_SLAB_N_CLASSES];
+    CachingMagazine* _magazines;
+    CachingChunk* _chunks;
+
+    // 0 until a thread first caches for it, then unique for as long as its registered as live
+    _Atomic u64 _generation;
+    struct CachingAllocator* _next_live;
+} CachingAllocator;
+#define MRW_CACHING_IMPL ._impl = { .alloc = _mrw_caching_alloc, .realloc = _mrw_caching_realloc, .free = _mrw_caching_free }
+
+// owner can be freed or reinitialized at the same address while a thread still holds this, so
+// its only ours while generation matches owner->_generation
+typedef struct {
+    CachingAllocator* owner;
+    u64 generation;
+    CachingMagazine* loaded[MRW_SLAB_N_CLASSES];
+    CachingMagazine* previous[MRW_SLAB_N_CLASSES];
+} _CachingThreadCache;
+
+thread_local _CachingThreadCache _mrw_caching_threads[MRW_CACHING_MAX_INSTANCES];
+thread_local u32 _mrw_caching_evict;
+
+// every allocator some thread caches for, stale thread caches get checked against this before
+// their owner is touched
+atomic_flag _mrw_caching_registry_lock = ATOMIC_FLAG_INIT;
+CachingAllocator* _mrw_caching_live;
+u64 _mrw_caching_generations;
+
+static inline void _caching_registry_lock(void) { while (atomic_flag_test_and_set_explicit(&_mrw_caching_registry_lock, memory_order_acquire)); }
+static inline void _caching_registry_unlock(void) { atomic_flag_clear_explicit(&_mrw_caching_registry_lock, memory_order_release); }
+
+// call with the registry locked
+static inline bool _caching_is_live(CachingAllocator* a, u64 generation)
+{
+    for (CachingAllocator* l = _mrw_caching_live; l; l = l->_next_live)
+        if (l == a) return atomic_load_explicit(&l->_generation, memory_order_relaxed) == generation;
+    return false;
+}
+
+static inline void _caching_lock(CachingAllocator* a) { while (atomic_flag_test_and_set_explicit(&a->_lock, memory_order_acquire)); }
+static inline void _caching_unlock(CachingAllocator* a) { atomic_flag_clear_explicit(&a->_lock, memory_order_release); }
+
+static inline void _caching_flush_cache(CachingAllocator* a, _CachingThreadCache* t);
+
+static inline _CachingThreadCache* _caching_thread_cache(CachingAllocator* a)
+{
+    u64 generation = atomic_load_explicit(&a->_generation, memory_order_acquire);
+    if (!generation) {
+        _caching_registry_lock();
+        generation = atomic_load_explicit(&a->_generation, memory_order_relaxed);
+        if (!generation) {
+            generation = ++_mrw_caching_generations;
+            a->_next_live = _mrw_caching_live;
+            _mrw_caching_live = a;
+            atomic_store_explicit(&a->_generation, generation, memory_order_release);
         }
+        _caching_registry_unlock();
+    }
 
-        BumpAllocatorBlock* prev = a->first;
-        if (size + align < size) mrw_abort("uhh");
-        usize capacity = max(prev ? (prev->capacity + prev->capacity / 2) : 1024, size + align);
-        a->first = (BumpAllocatorBlock*)_mrw_alloc(a->allocator, sizeof(BumpAllocatorBlock) + capacity, alignof(BumpAllocatorBlock));
-        *a->first = (BumpAllocatorBlock){ .next = prev, .capacity = capacity };
+    _CachingThreadCache* free_slot = nullptr;
+    for (u32 i = 0; i < MRW_CACHING_MAX_INSTANCES; i++) {
+        _CachingThreadCache* t = &_mrw_caching_threads[i];
+        if (t->owner == a && t->generation == generation) return t;
+        // left over from an earlier allocator at this address, its magazines are gone
+        if (t->owner == a) *t = (_CachingThreadCache){ 0 };
+        if (!t->owner && !free_slot) free_slot = t;
+    }
+
+    _CachingThreadCache* t = free_slot;
+    if (!t) {
+        _caching_registry_lock();
+        for (u32 i = 0; i < MRW_CACHING_MAX_INSTANCES && !t; i++)
+            if (!_caching_is_live(_mrw_caching_threads[i].owner, _mrw_caching_threads[i].generation)) t = &_mrw_caching_threads[i];
+        if (!t) {
+            // the owner cant be freed while the registry is locked
+            t = &_mrw_caching_threads[_mrw_caching_evict++ % MRW_CACHING_MAX_INSTANCES];
+            _caching_flush_cache(t->owner, t);
+        }
+        _caching_registry_unlock();
+    }
+    *t = (_CachingThreadCache){ .owner = a, .generation = generation };
+    return t;
+}
+
+static inline CachingMagazine* _caching_new_magazine(CachingAllocator* a)
+{
+    CachingMagazine* m = mrw_alloc(a->allocator, CachingMagazine);
+    m->next = nullptr;
+    m->count = 0;
+    _caching_lock(a);
+    m->all_next = a->_magazines;
+    a->_magazines = m;
+    _caching_unlock(a);
+    return m;
+}
+
+// carves a fresh chunk from the backing allocator into a full magazine
+static inline CachingMagazine* _caching_fill(CachingAllocator* a, u32 c)
+{
+    usize class_size = _mrw_slab_class_size(c);
+    usize object_align = _mrw_slab_class_align(c);
+    usize chunk_size = sizeof(CachingChunk) + object_align + class_size * MRW_CACHING_MAGAZINE_SIZE;
+    CachingChunk* chunk = (CachingChunk*)_mrw_alloc(a->allocator, chunk_size, alignof(CachingChunk));
+    chunk->size = chunk_size;
+
+    CachingMagazine* m = _caching_new_magazine(a);
+    u8* p = (u8*)ptr_align_up(chunk + 1, object_align);
+    for (u32 i = 0; i < MRW_CACHING_MAGAZINE_SIZE; i++)
+        m->items[i] = p + (MRW_CACHING_MAGAZINE_SIZE - 1 - i) * class_size;
+    m->count = MRW_CACHING_MAGAZINE_SIZE;
+
+    _caching_lock(a);
+    chunk->next = a->_chunks;
+    a->_chunks = chunk;
+    _caching_unlock(a);
+    return m;
+}
+
+static inline void* _mrw_caching_alloc(Allocator* allocator, usize size, usize align)
+{
+    CachingAllocator* a = (CachingAllocator*)allocator;
+    align = align ? align : 1;
+    if (size > MRW_SLAB_MAX_SIZE) return _mrw_alloc(a->allocator, size, align);
+    // the sized free would put it in a magazine instead of handing it back
+    if (align > MRW_SLAB_MAX_SIZE) mrw_abort("caching allocator cant align small objects past MRW_SLAB_MAX_SIZE");
+
+    u32 c = _mrw_slab_class_aligned(size, align);
+    _CachingThreadCache* t = _caching_thread_cache(a);
+    CachingMagazine* m = t->loaded[c];
+    if (m && m->count) return m->items[--m->count];
+
+    m = t->previous[c];
+    if (m && m->count) {
+        t->previous[c] = t->loaded[c];
+        t->loaded[c] = m;
+        return m->items[--m->count];
+    }
+
+    // both are empty, trade one for a full one
+    CachingMagazine* empty = t->previous[c];
+    t->previous[c] = t->loaded[c];
+    _caching_lock(a);
+    m = a->_depot[c].full;
+    if (m) a->_depot[c].full = m->next;
+    if (empty) {
+        empty->next = a->_depot[c].empty;
+        a->_depot[c].empty = empty;
+    }
+    _caching_unlock(a);
+
+    if (!m) m = _caching_fill(a, c);
+    t->loaded[c] = m;
+    return m->items[--m->count];
+}
+
+static inline void _mrw_caching_free(Allocator* allocator, void* ptr, usize size)
+{
+    CachingAllocator* a = (CachingAllocator*)allocator;
+    if (size > MRW_SLAB_MAX_SIZE) {
+        _mrw_free(a->allocator, ptr, size);
+        return;
+    }
+
+    u32 c = _mrw_slab_class(size);
+    _CachingThreadCache* t = _caching_thread_cache(a);
+    CachingMagazine* m = t->loaded[c];
+    if (m && m->count < MRW_CACHING_MAGAZINE_SIZE) {
+        m->items[m->count++] = ptr;
+        return;
+    }
+
+    m = t->previous[c];
+    if (m && m->count < MRW_CACHING_MAGAZINE_SIZE) {
+        t->previous[c] = t->loaded[c];
+        t->loaded[c] = m;
+        m->items[m->count++] = ptr;
+        return;
+    }
+
+    // both are full, trade one for an empty one
+    CachingMagazine* full = t->previous[c];
+    t->previous[c] = t->loaded[c];
+    _caching_lock(a);
+    if (full) {
+        full->next = a->_depot[c].full;
+        a->_depot[c].full = full;
+    }
+    m = a->_depot[c].empty;
+    if (m) a->_depot[c].empty = m->next;
+    _caching_unlock(a);
+
+    if (!m) m = _caching_new_magazine(a);
+    t->loaded[c] = m;
+    m->items[m->count++] = ptr;
+}
+
+static inline void* _mrw_caching_realloc(Allocator* allocator, void* ptr, usize old_size, usize new_size, usize align)
+{
+    CachingAllocator* a = (CachingAllocator*)allocator;
+    if (!ptr) return _mrw_caching_alloc(allocator, new_size, align);
+    if (old_size > MRW_SLAB_MAX_SIZE && new_size > MRW_SLAB_MAX_SIZE)
+        return _mrw_realloc(a->allocator, ptr, old_size, new_size, align);
+    if (_mrw_slab_realloc_in_place(ptr, old_size, new_size, align))
+        return ptr;
+
+    void* new_ptr = _mrw_caching_alloc(allocator, new_size, align);
+    buf_copy(new_ptr, ptr, min(old_size, new_size));
+    _mrw_caching_free(allocator, ptr, old_size);
+    return new_ptr;
+}
+
+static inline void _caching_flush_cache(CachingAllocator* a, _CachingThreadCache* t)
+{
+    _caching_lock(a);
+    for (u32 c = 0; c < MRW_SLAB_N_CLASSES; c++) {
+        CachingMagazine* magazines[] = { t->loaded[c], t->previous[c] };
+        array_for_each(magazines, m, CachingMagazine*) {
+            if (!*m) continue;
+            if ((*m)->count) { (*m)->next = a->_depot[c].full; a->_depot[c].full = *m; }
+            else { (*m)->next = a->_depot[c].empty; a->_depot[c].empty = *m; }
+        }
+    }
+    _caching_unlock(a);
+    *t = (_CachingThreadCache){ 0 };
+}
+
+// gives the calling threads magazines back to the depot
+static inline void mrw_caching_thread_flush(CachingAllocator* a)
+{
+    u64 generation = atomic_load_explicit(&a->_generation, memory_order_acquire);
+    for (u32 i = 0; i < MRW_CACHING_MAX_INSTANCES; i++) {
+        _CachingThreadCache* t = &_mrw_caching_threads[i];
+        if (t->owner != a) continue;
+        if (t->generation == generation) _caching_flush_cache(a, t);
+        else *t = (_CachingThreadCache){ 0 };
+    }
+}
+
+// every thread has to be done with the allocator. only the calling threads cache gets flushed, the
+// other threads drop theirs the next time they look at them
+static inline void mrw_caching_free(CachingAllocator* a)
+{
+    mrw_caching_thread_flush(a);
+    if (atomic_load_explicit(&a->_generation, memory_order_relaxed)) {
+        _caching_registry_lock();
+        CachingAllocator** l = &_mrw_caching_live;
+        while (*l != a) l = &(*l)->_next_live;
+        *l = a->_next_live;
+        _caching_registry_unlock();
+    }
+    for (CachingMagazine* m = a->_magazines; m;) {
+        CachingMagazine* next = m->all_next;
+        mrw_free(a->allocator, m);
+        m = next;
+    }
+    for (CachingChunk* chunk = a->_chunks; chunk;) {
+        CachingChunk* next = chunk->next;
+        _mrw_free(a->allocator, chunk, chunk->size);
+        chunk = next;
     }
+    *a = (CachingAllocator){ ._impl = a->_impl, .allocator = a->allocator };
 }
 
 #endif // MARROW_ALLOCATOR_H
@@ -9,7 +9,34 @@ typedef struct { union { u32 i; u32 valid; }; u32 gen; } GenarrHandle;
 // 0th element is sentinel
 // gen & 1 -> alive
 // n_items(from vektor) doesnt count freed stuff
-#define GENARR(T) VEKTOR(struct { u32 gen; u32 next_free; T val; })
+// occupancy has bit i set while slot i is alive, so iterating and clearing skip dead slots 64 at a time
+#define GENARR(T) \
+struct \
+{ \
+    struct { u32 gen; u32 next_free; T val; }* items; \
+    u64 n_items; \
+    u64 size; \
+    Allocator* _allocator; \
+    u32 _flags; \
+    u64* occupancy; \
+    u64 n_occupancy_words; \
+}
+
+// same thing with the generations and free list links in their own compact array, handle checks
+// only touch 8 bytes per slot no matter how big T is. genarr_is, genarr_remove and genarr_clear
+// work on both, the rest goes through the genarr_split_ versions
+#define GENARR_SPLIT(T) \
+struct \
+{ \
+    struct { u32 gen; u32 next_free; }* items; \
+    u64 n_items; \
+    u64 size; \
+    Allocator* _allocator; \
+    u32 _flags; \
+    u64* occupancy; \
+    u64 n_occupancy_words; \
+    VEKTOR(T) values; /* values.items[i] belongs to slot i, n_items isnt used */ \
+}
 
 #define GENARR_ITER(T) struct { T* _val; GenarrHandle handle; }
 #define GENARR_ITER_ALIAS(T, alias) struct { union { T* alias; T* _val; }; GenarrHandle handle; }
@@ -17,15 +44,41 @@ typedef struct { union { u32 i; u32 valid; }; u32 gen; } GenarrHandle;
 #define next_free(i) *(u32*)((*items) + (i) * item_size + next_free_offset)
 #define gen(i) *(u32*)((*items) + (i) * item_size)
 
-#define genarr_init(a, initial_size, allocator) vektor_init((a), (initial_size), (allocator))
-#define genarr_free(a) vektor_free((a))
+// keeps a word for every 64 slots of capacity
+static inline void _genarr_ensure_occupancy(u64** occupancy, u64* n_words, u64 size, Allocator* allocator)
+{
+    u64 n = (size + 63) / 64;
+    if (n <= *n_words) return;
+    *occupancy = (u64*)(*occupancy
+        ? _mrw_realloc(allocator, *occupancy, *n_words * sizeof(u64), n * sizeof(u64), alignof(u64))
+        : _mrw_alloc(allocator, n * sizeof(u64), alignof(u64)));
+    buf_set(*occupancy + *n_words, 0, (n - *n_words) * sizeof(u64));
+    *n_words = n;
+}
+
+#define genarr_init(a, initial_size, allocator) \
+do { \
+    vektor_init((a), (initial_size), (allocator)); \
+    (a).occupancy = nullptr; (a).n_occupancy_words = 0; \
+    _genarr_ensure_occupancy(&(a).occupancy, &(a).n_occupancy_words, (a).size, (a)._allocator); \
+} while (0)
+
+#define genarr_free(a) \
+do { \
+    vektor_free((a)); \
+    _mrw_free((a)._allocator, (a).occupancy, (a).n_occupancy_words * sizeof(u64)); \
+    (a).occupancy = nullptr; (a).n_occupancy_words = 0; \
+} while (0)
+
+// only touches live slots, everything past them is reused from index 1 again like a fresh genarr
 #define genarr_clear(a) \
 do { \
-    for (u32 _genarr_clear_i = 0; _genarr_clear_i < (a).size; _genarr_clear_i++) { \
-        if ((a).items[_genarr_clear_i].gen & 1)\
-            (a).items[_genarr_clear_i].gen++;\
-        (a).items[_genarr_clear_i].next_free = 0; \
-    }\
+    for (u64 _genarr_w = 0; _genarr_w < (a).n_occupancy_words; _genarr_w++) { \
+        for (u64 _genarr_bits = (a).occupancy[_genarr_w]; _genarr_bits; _genarr_bits &= _genarr_bits - 1) \
+            (a).items[_genarr_w * 64 + u64_ctz(_genarr_bits)].gen++; \
+        (a).occupancy[_genarr_w] = 0; \
+    } \
+    if ((a).size) (a).items[0].next_free = 0; \
     vektor_clear((a));\
 } while (0)
 
@@ -47,7 +100,9 @@ void _genarr_add(u8** items, u64* n_items, u64 item_size, u64 next_free_offset)
 
 #define genarr_add(a, ...) (\
     vektor_ensure((a), (a).n_items + 2)/*extra space for the sentinel*/,\
+    _genarr_ensure_occupancy(&(a).occupancy, &(a).n_occupancy_words, (a).size, (a)._allocator),\
     _genarr_add((u8**)&(a).items, &(a).n_items, sizeof(*(a).items), sizeof((a).items[0].gen)),\
+    BIT_SET((a).occupancy[_genarr_tmp_handle.i / 64], _genarr_tmp_handle.i % 64),\
     (a).items[_genarr_tmp_handle.i].val = (__VA_ARGS__),\
     _genarr_tmp_handle\
 )
@@ -55,19 +110,24 @@ void _genarr_add(u8** items, u64* n_items, u64 item_size, u64 next_free_offset)
 #define genarr_is(a, handle) (((handle).i < (a).size) && ((a).items[(handle).i].gen == (handle).gen) && ((a).items[(handle).i].gen & 1))
 #define genarr_get(a, handle) (genarr_is((a), (handle)) ? &((a).items[(handle).i]).val : nullptr)
 
-bool _genarr_next_valid(u8** items, u64 n_items, u64 item_size, GenarrHandle* handle)
+// finds the next set occupancy bit after handle->i
+bool _genarr_next_valid(u8** items, const u64* occupancy, u64 n_words, u64 item_size, GenarrHandle* handle)
 {
-    do { handle->i += 1; }
-    while (handle->i <= n_items && !(gen(handle->i) & 1));
-    if (handle->i <= n_items) {
-        handle->gen = gen(handle->i);
-        return true;
+    u64 i = (u64)handle->i + 1;
+    u64 w = i / 64;
+    if (w >= n_words) return false;
+    u64 bits = occupancy[w] & (~0ull << (i % 64));
+    while (!bits) {
+        if (++w >= n_words) return false;
+        bits = occupancy[w];
     }
-    return false;
+    handle->i = (u32)(w * 64 + u64_ctz(bits));
+    handle->gen = gen(handle->i);
+    return true;
 }
 
 #define genarr_next_valid(a, iter) (\
-    _genarr_next_valid((u8**)&(a).items, (a).n_items, sizeof(*(a).items), &(iter)->handle) ?\
+    _genarr_next_valid((u8**)&(a).items, (a).occupancy, (a).n_occupancy_words, sizeof(*(a).items), &(iter)->handle) ?\
         ((iter)->_val = &(a).items[(iter)->handle.i].val, true)\
         : false)
 
@@ -77,9 +137,143 @@ do { \
     (a).items[(handle).i].gen++;\
     (a).items[(handle).i].next_free = (a).items[0].next_free;\
     (a).items[0].next_free = (handle).i;\
+    BIT_CLEAR((a).occupancy[(handle).i / 64], (handle).i % 64);\
+} while (0)
+
+#define genarr_split_init(a, initial_size, allocator) \
+do { \
+    genarr_init((a), (initial_size), (allocator)); \
+    vektor_init((a).values, 0, (allocator)); \
+    vektor_reserve((a).values, (a).size); \
 } while (0)
 
+#define genarr_split_free(a) \
+do { \
+    genarr_free((a)); \
+    vektor_free((a).values); \
+} while (0)
+
+#define genarr_split_add(a, ...) (\
+    vektor_ensure((a), (a).n_items + 2)/*extra space for the sentinel*/,\
+    vektor_reserve((a).values, (a).size),\
+    _genarr_ensure_occupancy(&(a).occupancy, &(a).n_occupancy_words, (a).size, (a)._allocator),\
+    _genarr_add((u8**)&(a).items, &(a).n_items, sizeof(*(a).items), sizeof((a).items[0].gen)),\
+    BIT_SET((a).occupancy[_genarr_tmp_handle.i / 64], _genarr_tmp_handle.i % 64),\
+    (a).values.items[_genarr_tmp_handle.i] = (__VA_ARGS__),\
+    _genarr_tmp_handle\
+)
+
+#define genarr_split_get(a, handle) (genarr_is((a), (handle)) ? &(a).values.items[(handle).i] : nullptr)
+
+#define genarr_split_next_valid(a, iter) (\
+    _genarr_next_valid((u8**)&(a).items, (a).occupancy, (a).n_occupancy_words, sizeof(*(a).items), &(iter)->handle) ?\
+        ((iter)->_val = &(a).values.items[(iter)->handle.i], true)\
+        : false)
+
 #undef next_free
 #undef gen
 
+// slot map, live values are packed into values so iterating only ever touches live ones.
+// slots maps a handle to its index in values (or the next free slot once its dead), dense_slots
+// maps back from values to the slot so swap removes can patch the moved value
+// handles work the same as GENARR ones, pointers into values dont survive a remove
+typedef struct { u32 gen; u32 index; } GenarrSlot;
+
+#define DENSE_GENARR(T) \
+struct { \
+    VEKTOR(T) values; \
+    VEKTOR(u32) dense_slots; \
+    VEKTOR(GenarrSlot) slots; /* 0th element is sentinel, its index is the free list head */ \
+}
+
+#define dense_genarr_init(a, initial_size, allocator) \
+do { \
+    vektor_init((a).values, (initial_size), (allocator)); \
+    vektor_init((a).dense_slots, (initial_size), (allocator)); \
+    vektor_init((a).slots, (initial_size) + 1, (allocator)); \
+} while (0)
+
+#define dense_genarr_free(a) \
+do { \
+    vektor_free((a).values); \
+    vektor_free((a).dense_slots); \
+    vektor_free((a).slots); \
+} while (0)
+
+static inline GenarrHandle _dense_genarr_add(GenarrSlot* slots, u64* n_slots, u32* dense_slots, u64 dense_index)
+{
+    u32 i = slots[0].index;
+    if (i) slots[0].index = slots[i].index;
+    else i = (u32)++(*n_slots);
+    slots[i].gen += 1;
+    slots[i].index = (u32)dense_index;
+    dense_slots[dense_index] = i;
+    return (GenarrHandle){ .i = i, .gen = slots[i].gen };
+}
+
+// kills slot, the value at last was already moved into hole
+static inline void _dense_genarr_release(GenarrSlot* slots, u32* dense_slots, u32 slot, u32 hole, u32 last)
+{
+    u32 moved = dense_slots[last];
+    dense_slots[hole] = moved;
+    slots[moved].index = hole;
+    slots[slot].gen++;
+    slots[slot].index = slots[0].index;
+    slots[0].index = slot;
+}
+
+// O(live), only the live slots get their generation bumped
+static inline void _dense_genarr_clear(GenarrSlot* slots, u32* dense_slots, u64 n_values)
+{
+    for (u64 i = 0; i < n_values; i++) {
+        u32 slot = dense_slots[i];
+        slots[slot].gen++;
+        slots[slot].index = slots[0].index;
+        slots[0].index = slot;
+    }
+}
+
+#define dense_genarr_clear(a) \
+do { \
+    _dense_genarr_clear((a).slots.items, (a).dense_slots.items, (a).values.n_items); \
+    (a).values.n_items = (a).dense_slots.n_items = 0; \
+} while (0)
+
+#define dense_genarr_add(a, ...) (\
+    vektor_ensure((a).slots, (a).slots.n_items + 2)/*extra space for the sentinel*/,\
+    vektor_ensure((a).values, (a).values.n_items),\
+    vektor_ensure((a).dense_slots, (a).values.n_items),\
+    _genarr_tmp_handle = _dense_genarr_add((a).slots.items, &(a).slots.n_items, (a).dense_slots.items, (a).values.n_items),\
+    (a).dense_slots.n_items++,\
+    (a).values.items[(a).values.n_items++] = (__VA_ARGS__),\
+    _genarr_tmp_handle\
+)
+
+#define dense_genarr_is(a, handle) (((handle).i < (a).slots.size) && ((a).slots.items[(handle).i].gen == (handle).gen) && ((a).slots.items[(handle).i].gen & 1))
+#define dense_genarr_get(a, handle) (dense_genarr_is((a), (handle)) ? &(a).values.items[(a).slots.items[(handle).i].index] : nullptr)
+
+// handle of the value at index i of values
+#define dense_genarr_handle(a, index) \
+    ((GenarrHandle){ .i = (a).dense_slots.items[(index)], .gen = (a).slots.items[(a).dense_slots.items[(index)]].gen })
+
+// O(1), the last value is moved into the hole
+#define dense_genarr_remove(a, handle) \
+do { \
+    GenarrHandle _genarr_handle = (handle); \
+    if (!dense_genarr_is((a), _genarr_handle)) break; \
+    u32 _genarr_hole = (a).slots.items[_genarr_handle.i].index; \
+    u32 _genarr_last = (u32)--(a).values.n_items; \
+    (a).dense_slots.n_items--; \
+    (a).values.items[_genarr_hole] = (a).values.items[_genarr_last]; \
+    _dense_genarr_release((a).slots.items, (a).dense_slots.items, _genarr_handle.i, _genarr_hole, _genarr_last); \
+} while (0)
+
+// walks values back to front, so removing the current value while iterating is fine
+// for plain loops slice_vektor((a).values) does the same without handles
+#define dense_genarr_next_valid(a, iter) (\
+    ((iter)->_val ? (iter)->_val : (a).values.items + (a).values.n_items) != (a).values.items ?\
+        ((iter)->_val = ((iter)->_val ? (iter)->_val : (a).values.items + (a).values.n_items) - 1,\
+         (iter)->handle = dense_genarr_handle((a), (u64)((iter)->_val - (a).values.items)), true)\
+        : false)
+
 #endif // MARROW_VEKTOR_H
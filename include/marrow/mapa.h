@@ -8,6 +8,11 @@
 #define MAPA_INITIAL_CAPACITY 1
 #endif // MAPA_INITIAL_CAPACITY
 
+// slots an incremental mapa moves over or clears ahead per lookup and insert
+#ifndef MAPA_MIGRATE_STEP
+#define MAPA_MIGRATE_STEP 16
+#endif // MAPA_MIGRATE_STEP
+
 #ifndef MAPA_INITIAL_SEED
 #define MAPA_INITIAL_SEED 0x9747b28c
 #endif // MAPA_INITIAl_SEED
@@ -39,6 +44,18 @@ struct \
     mapa_hash_func _hash_func; \
     mapa_cmp_func _cmp_func; \
     Allocator* _allocator; \
+    u32 _entry_align; \
+\
+    /* incremental mode, the table thats still being moved out of while growing and the one */ \
+    /* thats getting cleared ahead of the next grow */ \
+    bool _incremental; \
+    void* _old_entries; \
+    u64 _old_size; \
+    u64 _old_start; \
+    u64 _old_moved; \
+    void* _next_entries; \
+    u64 _next_size; \
+    u64 _next_cleared; \
 \
     /* TODO: add owning */ \
 }
@@ -46,23 +63,48 @@ struct \
 #define mapa_init(m, hash_func, cmp_func, allocator) \
 do { \
     m._hash_func = hash_func; m._cmp_func = cmp_func; m._allocator = allocator; m.size = MAPA_INITIAL_CAPACITY; m.n_entries = 0;\
-    m.entries = _mrw_alloc(m._allocator, sizeof(m.entries[0]) * m.size, 1); \
+    m._entry_align = alignof_expr(m.entries[0]); \
+    m._incremental = false; m._old_entries = nullptr; m._old_size = 0; m._old_start = 0; m._old_moved = 0; \
+    m._next_entries = nullptr; m._next_size = 0; m._next_cleared = 0; \
+    _mrw_here(); m.entries = _mrw_alloc(m._allocator, sizeof(m.entries[0]) * m.size, m._entry_align); \
     buf_set(m.entries, 0, m.size * sizeof(*m.entries)); \
 } while(0)
 
+// growing doesnt touch the whole table in one go. past 0.4 load every lookup and insert clears
+// MAPA_MIGRATE_STEP slots of the next table, and once it grows they move MAPA_MIGRATE_STEP slots
+// of the old table over until its empty. keys that are still in the old table get moved over as
+// soon as theyre looked up. entries only has everything once mapa_migrate_all is called or the
+// migration finishes on its own
+#define mapa_init_incremental(m, hash_func, cmp_func, allocator) \
+do { \
+    mapa_init(m, hash_func, cmp_func, allocator); \
+    m._incremental = true; \
+} while(0)
+
 #define mapa_free(m) \
 do { \
     /* TODO: if owning free keys as well */ \
     _mrw_free(m._allocator, m.entries, m.size * sizeof(*m.entries)); \
+    if (m._old_entries) _mrw_free(m._allocator, m._old_entries, m._old_size * sizeof(*m.entries)); \
+    if (m._next_entries) _mrw_free(m._allocator, m._next_entries, m._next_size * sizeof(*m.entries)); \
+    m._old_entries = nullptr; m._old_size = 0; m._next_entries = nullptr; m._next_size = 0; \
     m.n_entries = 0; m.size = 0; m.entries = nullptr;\
 } while(0)
 
 typedef MAPA(u8, u8) _MAPA2;
 
+static inline void _mapa_step(_MAPA2* mapa, u32 key_size, u32 v_size, u32 entry_size);
+static inline void _mapa_pull_old(_MAPA2* mapa, void* key, u32 key_size, u32 v_size, u32 entry_size);
+
 // returns the index at which the element would be inserted if it existed
 static inline u64 _mapa_get_index(_MAPA2* mapa, void* key, u32 key_size, u32 v_size, u32 entry_size)
 {
     if (mapa->size == 0) return -1;
+    if (mapa->_incremental)
+    {
+        _mapa_step(mapa, key_size, v_size, entry_size);
+        if (mapa->_old_entries) _mapa_pull_old(mapa, key, key_size, v_size, entry_size);
+    }
 
     u8* entries = (u8*)mapa->entries;
     u64 index = mapa->_hash_func(key, key_size) % mapa->size;
@@ -83,7 +125,7 @@ static inline u64 _mapa_get_index(_MAPA2* mapa, void* key, u32 key_size, u32 v_s
 
 #define mapa_get_index(m, key_ptr) (_mapa_get_index((void*)&m, key_ptr, sizeof(m.entries[0]._v.key), sizeof(m.entries[0]._v), sizeof(*m.entries)))
 
-#define mapa_get_at_index(m, index) ((index <= m.size && m.entries[index].has_value) ? &m.entries[index]._v.value : nullptr)
+#define mapa_get_at_index(m, index) ((index < m.size && m.entries[index].has_value) ? &m.entries[index]._v.value : nullptr)
 
 thread_local u64 _mapa_i = -1;
 #define mapa_get(m, key) (_mapa_i = mapa_get_index(m, key), mapa_get_at_index(m, _mapa_i))
@@ -91,7 +133,7 @@ thread_local u64 _mapa_i = -1;
 static inline void _internal_mapa_grow(_MAPA2* mapa, u32 new_size, u32 key_size, u32 v_size, u32 entry_size)
 {
     u32 alloc_size = new_size * entry_size;
-    u8* new_entries = _mrw_alloc(mapa->_allocator, alloc_size, 1);
+    u8* new_entries = _mrw_alloc(mapa->_allocator, alloc_size, mapa->_entry_align);
     buf_set(new_entries, 0, alloc_size);
 
     u8* entries = (u8*)mapa->entries;
@@ -114,10 +156,151 @@ static inline void _internal_mapa_grow(_MAPA2* mapa, u32 new_size, u32 key_size,
     mapa->size = new_size;
 }
 
+// puts an entry thats known not to be in the new table into it
+static inline void _mapa_place(_MAPA2* mapa, void* entry, u32 key_size, u32 v_size, u32 entry_size)
+{
+    u8* entries = (u8*)mapa->entries;
+    u64 index = mapa->_hash_func(entry, key_size) % mapa->size;
+    while (*(bool*)(entries + entry_size * index + v_size))
+        index = (index + 1) % mapa->size;
+    buf_copy(entries + entry_size * index, entry, entry_size);
+}
+
+// the old table gets emptied slot by slot going forward from _old_start, which was an empty slot
+// so no probe run crosses it. a key whose home slot was already emptied can only be further on,
+// so probing the old table starts at the first slot that hasnt been moved yet
+static inline u64 _mapa_old_probe_start(_MAPA2* mapa, u64 home)
+{
+    u64 cursor = (mapa->_old_start + mapa->_old_moved) % mapa->_old_size;
+    bool moved = (home + mapa->_old_size - mapa->_old_start) % mapa->_old_size < mapa->_old_moved;
+    return moved ? cursor : home;
+}
+
+// moves key out of the old table into the new one if its still there
+static inline void _mapa_pull_old(_MAPA2* mapa, void* key, u32 key_size, u32 v_size, u32 entry_size)
+{
+    u8* old = (u8*)mapa->_old_entries;
+    u64 old_size = mapa->_old_size;
+    u64 hole = _mapa_old_probe_start(mapa, mapa->_hash_func(key, key_size) % old_size);
+    for (;; hole = (hole + 1) % old_size)
+    {
+        if (*(bool*)(old + entry_size * hole + v_size) == false) return;
+        if (mapa->_cmp_func(old + entry_size * hole, key, key_size) == 0) break;
+    }
+
+    _mapa_place(mapa, old + entry_size * hole, key_size, v_size, entry_size);
+    *(bool*)(old + entry_size * hole + v_size) = false;
+
+    // backward shift like mapa_remove_at_index, distances are measured from the cursor since
+    // nothing before it is in the old table anymore
+    u64 cursor = (mapa->_old_start + mapa->_old_moved) % old_size;
+    for (u64 j = (hole + 1) % old_size; *(bool*)(old + entry_size * j + v_size); j = (j + 1) % old_size)
+    {
+        u64 home = _mapa_old_probe_start(mapa, mapa->_hash_func(old + entry_size * j, key_size) % old_size);
+        if ((home + old_size - cursor) % old_size > (hole + old_size - cursor) % old_size) continue;
+        buf_copy(old + entry_size * hole, old + entry_size * j, entry_size);
+        *(bool*)(old + entry_size * j + v_size) = false;
+        hole = j;
+    }
+}
+
+// moves up to steps slots of the old table over, frees it once its empty
+static inline void _mapa_migrate(_MAPA2* mapa, u64 steps, u32 key_size, u32 v_size, u32 entry_size)
+{
+    u8* old = (u8*)mapa->_old_entries;
+    for (; steps && mapa->_old_moved < mapa->_old_size; steps--, mapa->_old_moved++)
+    {
+        u8* entry = old + entry_size * ((mapa->_old_start + mapa->_old_moved) % mapa->_old_size);
+        if (*(bool*)(entry + v_size) == false)
+            continue;
+        _mapa_place(mapa, entry, key_size, v_size, entry_size);
+        *(bool*)(entry + v_size) = false;
+    }
+
+    if (mapa->_old_moved == mapa->_old_size)
+    {
+        _mrw_free(mapa->_allocator, mapa->_old_entries, mapa->_old_size * entry_size);
+        mapa->_old_entries = nullptr;
+        mapa->_old_size = 0;
+    }
+}
+
+// the next table is what mapa_insert grows into, clearing it up front spreads the page faults of
+// a fresh allocation out as well
+static inline void _mapa_step(_MAPA2* mapa, u32 key_size, u32 v_size, u32 entry_size)
+{
+    if (mapa->_old_entries)
+    {
+        _mapa_migrate(mapa, MAPA_MIGRATE_STEP, key_size, v_size, entry_size);
+        return;
+    }
+
+    if (!mapa->_next_entries)
+    {
+        if (mapa->n_entries * 5 < mapa->size * 2) return;
+        mapa->_next_size = mapa->size * 2 + 1;
+        mapa->_next_cleared = 0;
+        mapa->_next_entries = _mrw_alloc(mapa->_allocator, mapa->_next_size * entry_size, mapa->_entry_align);
+    }
+
+    u64 n = min((u64)MAPA_MIGRATE_STEP, mapa->_next_size - mapa->_next_cleared);
+    buf_set((u8*)mapa->_next_entries + mapa->_next_cleared * entry_size, 0, n * entry_size);
+    mapa->_next_cleared += n;
+}
+
+static inline void _mapa_grow(_MAPA2* mapa, u32 new_size, u32 key_size, u32 v_size, u32 entry_size)
+{
+    if (mapa->_old_entries)
+        _mapa_migrate(mapa, mapa->_old_size, key_size, v_size, entry_size);
+
+    void* next = mapa->_next_entries;
+    if (next && mapa->_next_size != new_size)
+    {
+        _mrw_free(mapa->_allocator, next, mapa->_next_size * entry_size);
+        next = nullptr;
+    }
+    mapa->_next_entries = nullptr;
+
+    u64 start = 0;
+    u8* entries = (u8*)mapa->entries;
+    while (mapa->_incremental && start < mapa->size && *(bool*)(entries + entry_size * start + v_size))
+        start++;
+    // a full table has no slot that no probe run crosses, those are tiny anyway
+    if (!mapa->_incremental || start == mapa->size)
+    {
+        if (next) _mrw_free(mapa->_allocator, next, new_size * entry_size);
+        _internal_mapa_grow(mapa, new_size, key_size, v_size, entry_size);
+        return;
+    }
+
+    if (next)
+    {
+        buf_set((u8*)next + mapa->_next_cleared * entry_size, 0, (new_size - mapa->_next_cleared) * entry_size);
+    }
+    else
+    {
+        next = _mrw_alloc(mapa->_allocator, new_size * entry_size, mapa->_entry_align);
+        buf_set(next, 0, new_size * entry_size);
+    }
+
+    mapa->_old_entries = mapa->entries;
+    mapa->_old_size = mapa->size;
+    mapa->_old_start = start;
+    mapa->_old_moved = 0;
+    mapa->entries = next;
+    mapa->size = new_size;
+}
+
+// moves everything left in the old table over, after this entries has every key
+#define mapa_migrate_all(m) \
+do { \
+    if (m._old_entries) _mapa_migrate((void*)&m, m._old_size, sizeof((m).entries[0]._v.key), sizeof((m).entries[0]._v), sizeof((m).entries[0])); \
+} while(0)
+
 thread_local u64 _mapa_tmp_index = -1;
 #define mapa_insert(m, key_ptr, _value)(void*)( \
     m.n_entries >= m.size * 0.55 ? \
-        _internal_mapa_grow((void*)&m, m.size * 2 + 1, sizeof((m).entries[0]._v.key), sizeof((m).entries[0]._v), sizeof((m).entries[0])) : \
+        _mrw_here(), _mapa_grow((void*)&m, m.size * 2 + 1, sizeof((m).entries[0]._v.key), sizeof((m).entries[0]._v), sizeof((m).entries[0])), _mrw_here_end() : \
             (void)0, \
     _mapa_tmp_index = mapa_get_index(m, key_ptr), \
     !m.entries[_mapa_tmp_index].has_value ? (void)m.n_entries++ : (void)0, \
@@ -136,19 +319,23 @@ thread_local u64 _mapa_tmp_index = -1;
     &m.entries[index]._v.value \
 )
 
+// backward shift deletion, entries after the hole move into it unless that would put them before their home slot
 #define mapa_remove_at_index(m, index) \
 do { \
-    if (index >= m.size) break; \
-    m.entries[index].has_value = false; \
+    u64 _mapa_hole = (index); \
+    if (_mapa_hole >= m.size || !m.entries[_mapa_hole].has_value) break; \
+    m.entries[_mapa_hole].has_value = false; \
     m.n_entries--; \
-    for (u32 i = 0; i < m.size; i++) \
+    for (u64 _mapa_j = (_mapa_hole + 1) % m.size; m.entries[_mapa_j].has_value; _mapa_j = (_mapa_j + 1) % m.size) \
     { \
-        u32 next_index = (index + i + 1) % m.size; \
-        if (m.entries[next_index].has_value == false || \
-            next_index == (m._hash_func(&m.entries[next_index]._v.key, sizeof((m.entries)->_v.key)) % m.size)) \
-            break; \
-        m.entries[index] = m.entries[next_index]; \
-        m.entries[next_index].has_value = false; \
+        u64 _mapa_home = m._hash_func(&m.entries[_mapa_j]._v.key, sizeof((m.entries)->_v.key)) % m.size; \
+        bool _mapa_stays = _mapa_hole <= _mapa_j \
+            ? (_mapa_home > _mapa_hole && _mapa_home <= _mapa_j) \
+            : (_mapa_home > _mapa_hole || _mapa_home <= _mapa_j); \
+        if (_mapa_stays) continue; \
+        m.entries[_mapa_hole] = m.entries[_mapa_j]; \
+        m.entries[_mapa_j].has_value = false; \
+        _mapa_hole = _mapa_j; \
     } \
 } while(0)
 
@@ -0,0 +1,203 @@
+#ifndef MARROW_MAPA_ROBIN_H
+#define MARROW_MAPA_ROBIN_H
+
+#include "marrow.h"
+#include "marrow/alloc.h"
+#include "marrow/mapa.h"
+
+// robin hood flavoured mapa, same surface with a robin_ prefix
+//
+// every slot keeps the full hash of its key in hashes, next to entries. an insert that runs into
+// an entry closer to its home slot than the new key is to its own takes that slot and shifts the
+// rest of the run over by one, so probe lengths stay short and even at high load. the stored hash
+// is checked before cmp_func, and growing or removing never calls hash_func again
+//
+// the hash_func result gets mixed with hash_u64 first, identity hashes like mapa_hash_u64 are fine
+
+// the table grows past this many entries per 8 slots
+#ifndef MRW_ROBIN_MAX_LOAD
+#define MRW_ROBIN_MAX_LOAD 7
+#endif // MRW_ROBIN_MAX_LOAD
+
+// an insert that has to probe further than this grows the table even under the max load
+#ifndef MRW_ROBIN_MAX_PROBE
+#define MRW_ROBIN_MAX_PROBE 128
+#endif // MRW_ROBIN_MAX_PROBE
+
+#define ROBIN_MAPA(key_type, value_type) \
+struct \
+{ \
+    struct { \
+        key_type key; \
+        value_type value; \
+    }* entries; \
+    u64* hashes; /* 0 means the slot is empty */ \
+\
+    u64 n_entries; \
+    u64 size; \
+    u32 _entry_align; \
+\
+    mapa_hash_func _hash_func; \
+    mapa_cmp_func _cmp_func; \
+    Allocator* _allocator; \
+}
+
+typedef ROBIN_MAPA(u8, u8) _RobinMapa;
+
+// the top bit is always set so a stored hash is never 0
+static inline u64 _robin_hash(_RobinMapa* m, const void* key, u64 key_size) { return hash_u64(m->_hash_func(key, key_size)) | (1ull << 63); }
+
+// how far the entry in slot i is from its home slot
+static inline u64 _robin_dist(u64 hash, u64 i, u64 mask) { return (i - hash) & mask; }
+
+static inline void _robin_alloc(_RobinMapa* m, u64 size, u64 entry_size)
+{
+    m->size = size;
+    m->entries = (void*)_mrw_alloc(m->_allocator, size * entry_size, m->_entry_align);
+    m->hashes = (u64*)_mrw_alloc(m->_allocator, size * sizeof(u64), 16);
+    buf_set(m->hashes, 0, size * sizeof(u64));
+}
+
+// i is where hash belongs, moves the run starting there one slot over to the next empty one
+static inline void _robin_claim(_RobinMapa* m, u64 i, u64 hash, u64 entry_size)
+{
+    u64 mask = m->size - 1;
+    u64 end = i;
+    while (m->hashes[end]) end = (end + 1) & mask;
+    u8* entries = (u8*)m->entries;
+    for (u64 j = end; j != i; j = (j - 1) & mask) {
+        u64 prev = (j - 1) & mask;
+        m->hashes[j] = m->hashes[prev];
+        buf_copy(entries + j * entry_size, entries + prev * entry_size, entry_size);
+    }
+    m->hashes[i] = hash;
+}
+
+// slot hash should go into when the key isnt in the table, sets *probe to how far that is from home
+static inline u64 _robin_find_slot(_RobinMapa* m, u64 hash, u64* probe)
+{
+    u64 mask = m->size - 1;
+    u64 i = hash & mask;
+    u64 d = 0;
+    while (m->hashes[i] && _robin_dist(m->hashes[i], i, mask) >= d) {
+        i = (i + 1) & mask;
+        d++;
+    }
+    *probe = d;
+    return i;
+}
+
+static inline void _robin_resize(_RobinMapa* m, u64 new_size, u64 entry_size)
+{
+    _RobinMapa old = *m;
+    _robin_alloc(m, new_size, entry_size);
+    for (u64 i = 0; i < old.size; i++) {
+        if (!old.hashes[i]) continue;
+        u64 probe;
+        u64 slot = _robin_find_slot(m, old.hashes[i], &probe);
+        _robin_claim(m, slot, old.hashes[i], entry_size);
+        buf_copy((u8*)m->entries + slot * entry_size, (u8*)old.entries + i * entry_size, entry_size);
+    }
+    if (old.size) {
+        _mrw_free(m->_allocator, old.entries, old.size * entry_size);
+        _mrw_free(m->_allocator, old.hashes, old.size * sizeof(u64));
+    }
+}
+
+// index of key or -1
+static inline u64 _robin_get_index(_RobinMapa* m, const void* key, u64 hash, u64 key_size, u64 entry_size)
+{
+    if (m->size == 0) return -1;
+    u64 mask = m->size - 1;
+    u64 i = hash & mask;
+    // the entry is in another array than the hash, start pulling it in while the hash loads
+    mrw_prefetch((u8*)m->entries + i * entry_size);
+    for (u64 d = 0;; d++, i = (i + 1) & mask) {
+        u64 h = m->hashes[i];
+        // past this point the key would have displaced whatever is there
+        if (!h || _robin_dist(h, i, mask) < d) return -1;
+        if (h == hash && m->_cmp_func((u8*)m->entries + i * entry_size, key, key_size) == 0) return i;
+    }
+}
+
+// index key is at, claiming a slot for it if it wasnt there
+static inline u64 _robin_insert_slot(_RobinMapa* m, const void* key, u64 key_size, u64 entry_size)
+{
+    u64 hash = _robin_hash(m, key, key_size);
+    u64 i = _robin_get_index(m, key, hash, key_size, entry_size);
+    if (i != (u64)-1) return i;
+
+    if ((m->n_entries + 1) * 8 > m->size * MRW_ROBIN_MAX_LOAD)
+        _robin_resize(m, max(m->size * 2, (u64)16), entry_size);
+    u64 probe;
+    i = _robin_find_slot(m, hash, &probe);
+    // a bad hash can make long runs at any size, so only grow while the table is at least half full
+    while (probe > MRW_ROBIN_MAX_PROBE && m->n_entries * 2 >= m->size) {
+        _robin_resize(m, m->size * 2, entry_size);
+        i = _robin_find_slot(m, hash, &probe);
+    }
+    _robin_claim(m, i, hash, entry_size);
+    m->n_entries++;
+    return i;
+}
+
+// backward shift, the entries after i move back one until one is already in its home slot
+static inline void _robin_erase(_RobinMapa* m, u64 i, u64 entry_size)
+{
+    u64 mask = m->size - 1;
+    u8* entries = (u8*)m->entries;
+    for (u64 next = (i + 1) & mask; m->hashes[next] && _robin_dist(m->hashes[next], next, mask); next = (next + 1) & mask) {
+        m->hashes[i] = m->hashes[next];
+        buf_copy(entries + i * entry_size, entries + next * entry_size, entry_size);
+        i = next;
+    }
+    m->hashes[i] = 0;
+    m->n_entries--;
+}
+
+#define robin_mapa_init(m, hash_func, cmp_func, allocator) \
+do { \
+    (m)._hash_func = hash_func; (m)._cmp_func = cmp_func; (m)._allocator = allocator; \
+    (m)._entry_align = alignof_expr((m).entries[0]); \
+    (m).n_entries = 0; (m).size = 0; (m).entries = nullptr; (m).hashes = nullptr; \
+} while(0)
+
+#define robin_mapa_free(m) \
+do { \
+    if ((m).size) { \
+        _mrw_free((m)._allocator, (m).entries, (m).size * sizeof(*(m).entries)); \
+        _mrw_free((m)._allocator, (m).hashes, (m).size * sizeof(u64)); \
+    } \
+    (m).n_entries = 0; (m).size = 0; (m).entries = nullptr; (m).hashes = nullptr; \
+} while(0)
+
+// index of key or -1, unlike mapa_get_index theres no insert slot to hand out since inserting can
+// move other entries
+#define robin_mapa_get_index(m, key_ptr) \
+    (_robin_get_index((_RobinMapa*)&(m), (key_ptr), _robin_hash((_RobinMapa*)&(m), (key_ptr), sizeof((m).entries[0].key)), \
+        sizeof((m).entries[0].key), sizeof((m).entries[0])))
+
+#define robin_mapa_has_index(m, index) ((u64)(index) < (m).size && (m).hashes[(index)])
+
+#define robin_mapa_get_at_index(m, index) (robin_mapa_has_index((m), (index)) ? &(m).entries[(index)].value : nullptr)
+
+#define robin_mapa_get(m, key_ptr) (_mapa_i = robin_mapa_get_index((m), (key_ptr)), robin_mapa_get_at_index((m), _mapa_i))
+
+#define robin_mapa_insert(m, key_ptr, _value) ( \
+    _mrw_here(), \
+    _mapa_tmp_index = _robin_insert_slot((_RobinMapa*)&(m), (key_ptr), sizeof((m).entries[0].key), sizeof((m).entries[0])), \
+    _mrw_here_end(), \
+    (m).entries[_mapa_tmp_index].key = *(key_ptr), \
+    (m).entries[_mapa_tmp_index].value = (_value), \
+    &(m).entries[_mapa_tmp_index].value \
+)
+
+#define robin_mapa_remove_at_index(m, index) \
+do { \
+    u64 _robin_index = (index); \
+    if (robin_mapa_has_index((m), _robin_index)) _robin_erase((_RobinMapa*)&(m), _robin_index, sizeof((m).entries[0])); \
+} while(0)
+
+#define robin_mapa_remove(m, key_ptr) robin_mapa_remove_at_index((m), robin_mapa_get_index((m), (key_ptr)))
+
+#endif // MARROW_MAPA_ROBIN_H
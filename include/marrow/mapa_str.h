@@ -0,0 +1,130 @@
+#ifndef MARROW_MAPA_STR_H
+#define MARROW_MAPA_STR_H
+
+#include "marrow.h"
+#include "marrow/alloc.h"
+#include "marrow/mapa_robin.h"
+
+// str keyed mapa that owns its keys
+//
+//   STR_MAPA(i32) m; str_mapa_init(m, nullptr);
+//   str_mapa_insert(m, label, 5);   // label can point into a buffer thats about to go away
+//   i32* v = str_mapa_get(m, str("fps"));
+//
+// keys get hashed by content and the first insert of a key copies its bytes into a bump allocator
+// the map owns, so the str in the entry stays valid for as long as the map does. its a robin mapa
+// underneath, the full hash is kept per slot and the length is in the key, so mismatches almost
+// never get to the memcmp and growing never rehashes a string. removed keys keep their bytes until
+// str_mapa_clear or str_mapa_free
+
+// same layout as ROBIN_MAPA(str, value_type) with the key storage after it. robin_mapa_get,
+// _has_index, _get_at_index and _remove work on it too, robin_mapa_insert doesnt since it would
+// keep the callers str instead of copying the bytes
+#define STR_MAPA(value_type) \
+struct \
+{ \
+    struct { \
+        str key; \
+        value_type value; \
+    }* entries; \
+    u64* hashes; \
+\
+    u64 n_entries; \
+    u64 size; \
+    u32 _entry_align; \
+\
+    mapa_hash_func _hash_func; \
+    mapa_cmp_func _cmp_func; \
+    Allocator* _allocator; \
+\
+    BumpAllocator _keys; \
+}
+
+static inline u64 _str_mapa_rotl(u64 x, u32 r) { return (x << r) | (x >> (64 - r)); }
+
+// 8 bytes at a time, robin mapa mixes the result again so this only has to not lose bits
+static inline u64 mapa_hash_str(const void* key, u64 key_size)
+{
+    str s = *(const str*)key;
+    const char* p = s.start;
+    usize len = str_len(s);
+    u64 hash = MAPA_INITIAL_SEED ^ (len * 0x9e3779b97f4a7c15ULL);
+    for (; len >= 8; len -= 8, p += 8) {
+        u64 v; buf_copy(&v, p, 8);
+        hash = (_str_mapa_rotl(hash, 29) ^ v) * 0x9e3779b97f4a7c15ULL;
+    }
+    if (len) {
+        u64 v = 0; buf_copy(&v, p, len);
+        hash = (_str_mapa_rotl(hash, 29) ^ v) * 0x9e3779b97f4a7c15ULL;
+    }
+    return hash;
+}
+
+static inline u8 mapa_cmp_str(const void* a, const void* b, u64 key_size)
+{
+    str x = *(const str*)a, y = *(const str*)b;
+    usize len = str_len(x);
+    return len != str_len(y) || memcmp(x.start, y.start, len) != 0;
+}
+
+// slot key is at, a new key gets its bytes copied into the map first
+static inline u64 _str_mapa_insert_slot(_RobinMapa* m, BumpAllocator* keys, str key, u64 entry_size)
+{
+    u64 n_entries = m->n_entries;
+    u64 i = _robin_insert_slot(m, &key, sizeof(str), entry_size);
+    if (m->n_entries != n_entries) {
+        usize len = str_len(key);
+        char* copy = (char*)_mrw_alloc(&keys->_impl, len, 1);
+        buf_copy(copy, key.start, len);
+        *(str*)((u8*)m->entries + i * entry_size) = (str)slice(copy, copy + len);
+    }
+    return i;
+}
+
+thread_local str _str_mapa_key;
+
+#define str_mapa_init(m, backing) \
+do { \
+    robin_mapa_init((m), mapa_hash_str, mapa_cmp_str, (backing)); \
+    (m)._keys = (BumpAllocator){ MRW_BUMP_IMPL, .allocator = (backing) }; \
+} while(0)
+
+#define str_mapa_free(m) \
+do { \
+    robin_mapa_free((m)); \
+    mrw_bump_free(&(m)._keys); \
+} while(0)
+
+// drops every entry and key but keeps the memory around for the next ones
+#define str_mapa_clear(m) \
+do { \
+    if ((m).size) buf_set((m).hashes, 0, (m).size * sizeof(u64)); \
+    (m).n_entries = 0; \
+    mrw_bump_reset(&(m)._keys); \
+} while(0)
+
+#define str_mapa_get_index(m, key) (_str_mapa_key = (key), robin_mapa_get_index((m), &_str_mapa_key))
+
+#define str_mapa_has_index(m, index) robin_mapa_has_index((m), (index))
+
+#define str_mapa_get_at_index(m, index) robin_mapa_get_at_index((m), (index))
+
+#define str_mapa_get(m, key) (_str_mapa_key = (key), robin_mapa_get((m), &_str_mapa_key))
+
+#define str_mapa_insert(m, key, _value) ( \
+    _mrw_here(), \
+    _mapa_tmp_index = _str_mapa_insert_slot((_RobinMapa*)&(m), &(m)._keys, (key), sizeof((m).entries[0])), \
+    _mrw_here_end(), \
+    (m).entries[_mapa_tmp_index].value = (_value), \
+    &(m).entries[_mapa_tmp_index].value \
+)
+
+#define str_mapa_remove_at_index(m, index) robin_mapa_remove_at_index((m), (index))
+
+#define str_mapa_remove(m, key) \
+do { \
+    _str_mapa_key = (key); \
+    robin_mapa_remove((m), &_str_mapa_key); \
+} while(0)
+
+#endif // MARROW_MAPA_STR_H
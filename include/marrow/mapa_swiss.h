@@ -0,0 +1,370 @@
+#ifndef MARROW_MAPA_SWISS_H
+#define MARROW_MAPA_SWISS_H
+
+#include "marrow.h"
+#include "marrow/alloc.h"
+#include "marrow/mapa.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MRW_SWISS_SSE2
+#endif
+
+// swiss table flavoured mapa, same surface with a swiss_ prefix
+//
+// every slot has a control byte next to it in ctrl, either empty, deleted or the low 7 bits of the
+// hash of the key thats there. lookups compare 16 control bytes at once (sse2 when its there) and
+// only call cmp_func for the ones whose 7 bits match, probing goes group by group over a power of
+// two capacity so theres no modulo anywhere
+//
+// the hash_func result gets mixed with hash_u64 first, identity hashes like mapa_hash_u64 are fine
+
+#define SWISS_GROUP 16
+#define SWISS_EMPTY ((i8)-128)
+#define SWISS_DELETED ((i8)-2)
+
+#define SWISS_MAPA(key_type, value_type) \
+struct \
+{ \
+    struct { \
+        key_type key; \
+        value_type value; \
+    }* entries; \
+    i8* ctrl; /* size + SWISS_GROUP bytes, the tail mirrors the first group so loads can run past the end */ \
+\
+    u64 n_entries; \
+    u64 size; \
+    u64 _growth_left; \
+    u32 _entry_align; \
+\
+    mapa_hash_func _hash_func; \
+    mapa_cmp_func _cmp_func; \
+    Allocator* _allocator; \
+}
+
+typedef SWISS_MAPA(u8, u8) _SwissMapa;
+
+// bit i is set for every byte of the group that equals h
+static inline u32 _swiss_match(const i8* group, i8 h)
+{
+#ifdef MRW_SWISS_SSE2
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h)));
+#else
+    u32 mask = 0;
+    for (u32 i = 0; i < SWISS_GROUP; i++) mask |= (u32)(group[i] == h) << i;
+    return mask;
+#endif
+}
+
+static inline u32 _swiss_match_empty_or_deleted(const i8* group)
+{
+#ifdef MRW_SWISS_SSE2
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (u32)_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), ctrl));
+#else
+    u32 mask = 0;
+    for (u32 i = 0; i < SWISS_GROUP; i++) mask |= (u32)(group[i] < -1) << i;
+    return mask;
+#endif
+}
+
+static inline u64 _swiss_hash(_SwissMapa* m, const void* key, u64 key_size) { return hash_u64(m->_hash_func(key, key_size)); }
+static inline i8 _swiss_h2(u64 hash) { return (i8)(hash & 0x7f); }
+
+static inline void _swiss_ctrl_set(i8* ctrl, u64 size, u64 i, i8 h)
+{
+    ctrl[i] = h;
+    ctrl[((i - SWISS_GROUP) & (size - 1)) + SWISS_GROUP] = h;
+}
+
+static inline void _swiss_set_ctrl(_SwissMapa* m, u64 i, i8 h) { _swiss_ctrl_set(m->ctrl, m->size, i, h); }
+
+// 7/8 of the slots can be used
+static inline u64 _swiss_capacity(u64 size) { return size - size / 8; }
+
+static inline void _swiss_alloc(_SwissMapa* m, u64 size, u64 entry_size)
+{
+    m->size = size;
+    m->entries = (void*)_mrw_alloc(m->_allocator, size * entry_size, m->_entry_align);
+    m->ctrl = (i8*)_mrw_alloc(m->_allocator, size + SWISS_GROUP, 16);
+    buf_set(m->ctrl, (u8)SWISS_EMPTY, size + SWISS_GROUP);
+    m->_growth_left = _swiss_capacity(size);
+}
+
+// first empty or deleted slot on the probe path, used on inserts that already know the key isnt there
+static inline u64 _swiss_ctrl_find_free(const i8* ctrl, u64 size, u64 hash)
+{
+    u64 mask = size - 1;
+    u64 pos = (hash >> 7) & mask;
+    for (u64 step = SWISS_GROUP;; step += SWISS_GROUP) {
+        u32 free = _swiss_match_empty_or_deleted(ctrl + pos);
+        if (free) return (pos + u64_ctz(free)) & mask;
+        pos = (pos + step) & mask;
+    }
+}
+
+static inline u64 _swiss_find_free(_SwissMapa* m, u64 hash) { return _swiss_ctrl_find_free(m->ctrl, m->size, hash); }
+
+static inline void _swiss_resize(_SwissMapa* m, u64 new_size, u64 key_size, u64 entry_size)
+{
+    _SwissMapa old = *m;
+    _swiss_alloc(m, new_size, entry_size);
+    for (u64 i = 0; i < old.size; i++) {
+        if (old.ctrl[i] < 0) continue;
+        u8* entry = (u8*)old.entries + i * entry_size;
+        u64 hash = _swiss_hash(m, entry, key_size);
+        u64 slot = _swiss_find_free(m, hash);
+        _swiss_set_ctrl(m, slot, _swiss_h2(hash));
+        buf_copy((u8*)m->entries + slot * entry_size, entry, entry_size);
+    }
+    m->_growth_left -= m->n_entries;
+    if (old.size) {
+        _mrw_free(m->_allocator, old.entries, old.size * entry_size);
+        _mrw_free(m->_allocator, old.ctrl, old.size + SWISS_GROUP);
+    }
+}
+
+// makes sure theres room for one more entry, tombstones get cleaned out by rehashing in place
+// when theres lots of them instead of growing
+static inline void _swiss_reserve_one(_SwissMapa* m, u64 key_size, u64 entry_size)
+{
+    if (m->_growth_left) return;
+    u64 new_size = m->n_entries * 16 <= _swiss_capacity(m->size) * 7 ? m->size : m->size * 2;
+    _swiss_resize(m, max(new_size, (u64)SWISS_GROUP), key_size, entry_size);
+}
+
+thread_local u64 _swiss_last_hash;
+
+// returns the index of key, or the slot it would be inserted into if it isnt there
+static inline u64 _swiss_get_index(_SwissMapa* m, const void* key, u64 key_size, u64 entry_size)
+{
+    if (m->size == 0) return -1;
+    u64 hash = _swiss_last_hash = _swiss_hash(m, key, key_size);
+    i8 h2 = _swiss_h2(hash);
+    u64 mask = m->size - 1;
+    u64 pos = (hash >> 7) & mask;
+    u64 first_free = -1;
+    // the key is most likely within the first group, start pulling it in while the control bytes load
+    mrw_prefetch((u8*)m->entries + pos * entry_size);
+    for (u64 step = SWISS_GROUP;; step += SWISS_GROUP) {
+        const i8* group = m->ctrl + pos;
+        for (u32 match = _swiss_match(group, h2); match; match &= match - 1) {
+            u64 i = (pos + u64_ctz(match)) & mask;
+            if (m->_cmp_func((u8*)m->entries + i * entry_size, key, key_size) == 0) return i;
+        }
+        if (first_free == (u64)-1) {
+            u32 free = _swiss_match_empty_or_deleted(group);
+            if (free) first_free = (pos + u64_ctz(free)) & mask;
+        }
+        if (_swiss_match(group, SWISS_EMPTY)) return first_free;
+        pos = (pos + step) & mask;
+        if (step > m->size) return first_free;
+    }
+}
+
+// slot to insert key into given what _swiss_get_index returned for it, the table only grows when
+// the key isnt there and would take up an empty slot, and then the key gets looked up again
+static inline u64 _swiss_insert_index(_SwissMapa* m, u64 i, const void* key, u64 key_size, u64 entry_size)
+{
+    if (i != (u64)-1 && (m->ctrl[i] != SWISS_EMPTY || m->_growth_left)) return i;
+    _swiss_reserve_one(m, key_size, entry_size);
+    return _swiss_get_index(m, key, key_size, entry_size);
+}
+
+// an empty slot can become a tombstone or go straight back to empty when no probe could have
+// gone past it, ie theres an empty slot within a group on both sides
+// returns true if the slot went back to empty
+static inline bool _swiss_ctrl_erase(i8* ctrl, u64 size, u64 i)
+{
+    u64 mask = size - 1;
+    u32 empty_before = _swiss_match(ctrl + ((i - SWISS_GROUP) & mask), SWISS_EMPTY);
+    u32 empty_after = _swiss_match(ctrl + i, SWISS_EMPTY);
+    bool never_full = empty_before && empty_after &&
+        (u64_ctz(empty_after) + (u64_log2(empty_before) ^ (SWISS_GROUP - 1))) < SWISS_GROUP;
+    _swiss_ctrl_set(ctrl, size, i, never_full ? SWISS_EMPTY : SWISS_DELETED);
+    return never_full;
+}
+
+static inline void _swiss_erase(_SwissMapa* m, u64 i)
+{
+    if (_swiss_ctrl_erase(m->ctrl, m->size, i)) m->_growth_left++;
+    m->n_entries--;
+}
+
+#define swiss_mapa_init(m, hash_func, cmp_func, allocator) \
+do { \
+    (m)._hash_func = hash_func; (m)._cmp_func = cmp_func; (m)._allocator = allocator; \
+    (m)._entry_align = alignof_expr((m).entries[0]); \
+    (m).n_entries = 0; (m).size = 0; (m)._growth_left = 0; (m).entries = nullptr; (m).ctrl = nullptr; \
+} while(0)
+
+#define swiss_mapa_free(m) \
+do { \
+    if ((m).size) { \
+        _mrw_free((m)._allocator, (m).entries, (m).size * sizeof(*(m).entries)); \
+        _mrw_free((m)._allocator, (m).ctrl, (m).size + SWISS_GROUP); \
+    } \
+    (m).n_entries = 0; (m).size = 0; (m)._growth_left = 0; (m).entries = nullptr; (m).ctrl = nullptr; \
+} while(0)
+
+#define swiss_mapa_get_index(m, key_ptr) \
+    (_swiss_get_index((_SwissMapa*)&(m), (key_ptr), sizeof((m).entries[0].key), sizeof((m).entries[0])))
+
+#define swiss_mapa_has_index(m, index) ((u64)(index) < (m).size && (m).ctrl[(index)] >= 0)
+
+#define swiss_mapa_get_at_index(m, index) (swiss_mapa_has_index((m), (index)) ? &(m).entries[(index)].value : nullptr)
+
+#define swiss_mapa_get(m, key_ptr) (_mapa_i = swiss_mapa_get_index((m), (key_ptr)), swiss_mapa_get_at_index((m), _mapa_i))
+
+// index has to come from swiss_mapa_get_index with nothing inserted in between, key_ptr has to be
+// the same key. when the slot cant take a new key (-1 or no growth left) the table grows first
+#define swiss_mapa_insert_at_index(m, index, key_ptr, _value) ( \
+    _mrw_here(), \
+    _mapa_tmp_index = _swiss_insert_index((_SwissMapa*)&(m), (index), (key_ptr), sizeof((m).entries[0].key), sizeof((m).entries[0])), \
+    _mrw_here_end(), \
+    !swiss_mapa_has_index((m), _mapa_tmp_index) ? \
+        ((m).n_entries++, (m)._growth_left -= (m).ctrl[_mapa_tmp_index] == SWISS_EMPTY, \
+         _swiss_set_ctrl((_SwissMapa*)&(m), _mapa_tmp_index, _swiss_h2(_swiss_last_hash))) : (void)0, \
+    (m).entries[_mapa_tmp_index].key = *(key_ptr), \
+    (m).entries[_mapa_tmp_index].value = (_value), \
+    &(m).entries[_mapa_tmp_index].value \
+)
+
+#define swiss_mapa_insert(m, key_ptr, _value) \
+    swiss_mapa_insert_at_index((m), swiss_mapa_get_index((m), (key_ptr)), (key_ptr), (_value))
+
+#define swiss_mapa_remove_at_index(m, index) \
+do { \
+    u64 _swiss_index = (index); \
+    if (swiss_mapa_has_index((m), _swiss_index)) _swiss_erase((_SwissMapa*)&(m), _swiss_index); \
+} while(0)
+
+#define swiss_mapa_remove(m, key_ptr) swiss_mapa_remove_at_index((m), swiss_mapa_get_index((m), (key_ptr)))
+
+// typed swiss mapa with the hash and compare inlined instead of going through function pointers
+//
+//   MAPA_DEFINE(Ids, u64, u32, mapa_inline_hash_int, mapa_inline_eq);
+//   Ids ids; Ids_init(&ids, 0, nullptr);
+//   Ids_insert(&ids, 42, 7);
+//   u32* v = Ids_get(&ids, 42);
+//
+// hash_fn(const K*) returns a u64 and gets mixed like swiss_mapa does, eq_fn(const K*, const K*)
+// is true when the keys are the same, both can be functions or macros. swiss_mapa_has_index and
+// swiss_mapa_get_at_index work on it for iterating. the functions dont record a callsite, their
+// allocations show up under "unknown" in track.h
+
+#define mapa_inline_hash_int(key) ((u64)*(key))
+#define mapa_inline_eq(a, b) (*(a) == *(b))
+
+#define MAPA_DEFINE(Name, key_type, value_type, hash_fn, eq_fn) \
+typedef struct Name { \
+    struct { \
+        key_type key; \
+        value_type value; \
+    }* entries; \
+    i8* ctrl; \
+    u64 n_entries; \
+    u64 size; \
+    u64 _growth_left; \
+    Allocator* _allocator; \
+} Name; \
+static inline u64 _##Name##_hash(const key_type* key) { return hash_u64(hash_fn(key)); } \
+static inline void Name##_grow(Name* m, u64 new_size) { \
+    Name old = *m; \
+    new_size = u64_nextpow2(max(new_size, (u64)SWISS_GROUP) - 1); \
+    m->size = new_size; \
+    m->entries = (void*)_mrw_alloc(m->_allocator, new_size * sizeof(*m->entries), alignof_expr(*m->entries)); \
+    m->ctrl = (i8*)_mrw_alloc(m->_allocator, new_size + SWISS_GROUP, 16); \
+    buf_set(m->ctrl, (u8)SWISS_EMPTY, new_size + SWISS_GROUP); \
+    m->_growth_left = _swiss_capacity(new_size) - m->n_entries; \
+    for (u64 i = 0; i < old.size; i++) { \
+        if (old.ctrl[i] < 0) continue; \
+        u64 hash = _##Name##_hash(&old.entries[i].key); \
+        u64 slot = _swiss_ctrl_find_free(m->ctrl, new_size, hash); \
+        _swiss_ctrl_set(m->ctrl, new_size, slot, _swiss_h2(hash)); \
+        m->entries[slot] = old.entries[i]; \
+    } \
+    if (old.size) { \
+        _mrw_free(m->_allocator, old.entries, old.size * sizeof(*old.entries)); \
+        _mrw_free(m->_allocator, old.ctrl, old.size + SWISS_GROUP); \
+    } \
+} \
+/* makes sure count entries fit without growing */ \
+static inline void Name##_reserve(Name* m, u64 count) { \
+    if (count > m->n_entries + m->_growth_left) { \
+        u64 size = max(m->size, (u64)SWISS_GROUP); \
+        while (_swiss_capacity(size) < count) size *= 2; \
+        Name##_grow(m, size); \
+    } \
+} \
+static inline void Name##_init(Name* m, u64 initial_size, Allocator* allocator) { \
+    *m = (Name){ ._allocator = allocator }; \
+    if (initial_size) Name##_reserve(m, initial_size); \
+} \
+static inline void Name##_free(Name* m) { \
+    if (m->size) { \
+        _mrw_free(m->_allocator, m->entries, m->size * sizeof(*m->entries)); \
+        _mrw_free(m->_allocator, m->ctrl, m->size + SWISS_GROUP); \
+    } \
+    *m = (Name){ ._allocator = m->_allocator }; \
+} \
+static inline void Name##_clear(Name* m) { \
+    if (m->size) buf_set(m->ctrl, (u8)SWISS_EMPTY, m->size + SWISS_GROUP); \
+    m->n_entries = 0; \
+    m->_growth_left = m->size ? _swiss_capacity(m->size) : 0; \
+} \
+/* index of key or -1 */ \
+static inline u64 _##Name##_find(const Name* m, const key_type* key, u64 hash) { \
+    if (m->size == 0) return -1; \
+    i8 h2 = _swiss_h2(hash); \
+    u64 mask = m->size - 1; \
+    u64 pos = (hash >> 7) & mask; \
+    mrw_prefetch(&m->entries[pos]); \
+    for (u64 step = SWISS_GROUP;; step += SWISS_GROUP) { \
+        const i8* group = m->ctrl + pos; \
+        for (u32 match = _swiss_match(group, h2); match; match &= match - 1) { \
+            u64 i = (pos + u64_ctz(match)) & mask; \
+            if (eq_fn(&m->entries[i].key, key)) return i; \
+        } \
+        if (_swiss_match(group, SWISS_EMPTY) || step > m->size) return -1; \
+        pos = (pos + step) & mask; \
+    } \
+} \
+static inline u64 Name##_get_index(const Name* m, key_type key) { return _##Name##_find(m, &key, _##Name##_hash(&key)); } \
+static inline value_type* Name##_get(Name* m, key_type key) { \
+    u64 i = _##Name##_find(m, &key, _##Name##_hash(&key)); \
+    return i == (u64)-1 ? nullptr : &m->entries[i].value; \
+} \
+/* overwrites the value if the key is already there */ \
+static inline value_type* Name##_insert(Name* m, key_type key, value_type value) { \
+    u64 hash = _##Name##_hash(&key); \
+    u64 i = _##Name##_find(m, &key, hash); \
+    if (i == (u64)-1) { \
+        if (m->_growth_left == 0) { \
+            /* mostly tombstones, rehash at the same size */ \
+            Name##_grow(m, m->n_entries * 16 <= _swiss_capacity(m->size) * 7 ? m->size : m->size * 2); \
+        } \
+        i = _swiss_ctrl_find_free(m->ctrl, m->size, hash); \
+        m->_growth_left -= m->ctrl[i] == SWISS_EMPTY; \
+        m->n_entries++; \
+        _swiss_ctrl_set(m->ctrl, m->size, i, _swiss_h2(hash)); \
+        m->entries[i].key = key; \
+    } \
+    m->entries[i].value = value; \
+    return &m->entries[i].value; \
+} \
+static inline void Name##_remove_at_index(Name* m, u64 index) { \
+    if (!swiss_mapa_has_index(*m, index)) return; \
+    if (_swiss_ctrl_erase(m->ctrl, m->size, index)) m->_growth_left++; \
+    m->n_entries--; \
+} \
+/* returns true if the key was there */ \
+static inline bool Name##_remove(Name* m, key_type key) { \
+    u64 i = Name##_get_index(m, key); \
+    if (i == (u64)-1) return false; \
+    Name##_remove_at_index(m, i); \
+    return true; \
+}
+
+#endif // MARROW_MAPA_SWISS_H
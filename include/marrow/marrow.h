@@ -3,8 +3,13 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
+#ifdef _MSC_VER
+#include <intrin.h> // _BitScanReverse64 and _BitScanForward64 for u64_log2 and u64_ctz
+#endif
+
 #define PRINTCCY_CUSTOM_TYPES str: mrw_print_str
 #include <printccy/printccy.h>
 
@@ -76,6 +81,9 @@ typedef _Bool         bool;
 
 #endif // C_VERSION <= C17
 
+// alignof only takes a type in standard C
+#define alignof_expr(x) alignof(__typeof__(x))
+
 #define var auto
 #define let const auto
 
@@ -107,6 +115,29 @@ typedef _Bool         bool;
 #define LINE_UNIQUE_I LINE_UNIQUE_VAR(i)
 #endif //LINE_UNIQUE_VAR
 
+#ifndef MRW_FOR_EACH
+// counts and maps over up to 16 macro arguments
+#define MRW_NARGS(...) _MRW_NARGS(__VA_ARGS__, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1)
+#define _MRW_NARGS(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, N, ...) N
+#define MRW_FOR_EACH(m, ...) LINE_UNIQUE_VAR_PASS(_MRW_FOR_EACH_, MRW_NARGS(__VA_ARGS__))(m, __VA_ARGS__)
+#define _MRW_FOR_EACH_1(m, a) m(a)
+#define _MRW_FOR_EACH_2(m, a, ...) m(a) _MRW_FOR_EACH_1(m, __VA_ARGS__)
+#define _MRW_FOR_EACH_3(m, a, ...) m(a) _MRW_FOR_EACH_2(m, __VA_ARGS__)
+#define _MRW_FOR_EACH_4(m, a, ...) m(a) _MRW_FOR_EACH_3(m, __VA_ARGS__)
+#define _MRW_FOR_EACH_5(m, a, ...) m(a) _MRW_FOR_EACH_4(m, __VA_ARGS__)
+#define _MRW_FOR_EACH_6(m, a, ...) m(a) _MRW_FOR_EACH_5(m, __VA_ARGS__)
+#define _MRW_FOR_EACH_7(m, a, ...) m(a) _MRW_FOR_EACH_6(m, __VA_ARGS__)
+#define _MRW_FOR_EACH_8(m, a, ...) m(a) _MRW_FOR_EACH_7(m, __VA_ARGS__)
+#define _MRW_FOR_EACH_9(m, a, ...) m(a) _MRW_FOR_EACH_8(m, __VA_ARGS__)
+#define _MRW_FOR_EACH_10(m, a, ...) m(a) _MRW_FOR_EACH_9(m, __VA_ARGS__)
+#define _MRW_FOR_EACH_11(m, a, ...) m(a) _MRW_FOR_EACH_10(m, __VA_ARGS__)
+#define _MRW_FOR_EACH_12(m, a, ...) m(a) _MRW_FOR_EACH_11(m, __VA_ARGS__)
+#define _MRW_FOR_EACH_13(m, a, ...) m(a) _MRW_FOR_EACH_12(m, __VA_ARGS__)
+#define _MRW_FOR_EACH_14(m, a, ...) m(a) _MRW_FOR_EACH_13(m, __VA_ARGS__)
+#define _MRW_FOR_EACH_15(m, a, ...) m(a) _MRW_FOR_EACH_14(m, __VA_ARGS__)
+#define _MRW_FOR_EACH_16(m, a, ...) m(a) _MRW_FOR_EACH_15(m, __VA_ARGS__)
+#endif // MRW_FOR_EACH
+
 #ifndef max
 #define max(a, b) (((a) > (b)) ? (a) : (b))
 #endif // max
@@ -151,9 +182,17 @@ static inline u8 i32_n_digits(i32 v)
 #define array_for_each_i(arr, i) for(usize i = 0; (i) < array_len((arr)); (i)++)
 #endif // array_len
 
+// these go through the libc versions which copy in vector sized blocks
+// dst and source cant overlap, use buf_move when they might
 static inline void buf_copy(void* dst, const void* source, usize len)
 {
-    while(len--) ((u8*)dst)[len] = ((u8*)source)[len];
+    memcpy(dst, source, len);
+}
+
+// buf_copy for ranges that might overlap
+static inline void buf_move(void* dst, const void* source, usize len)
+{
+    memmove(dst, source, len);
 }
 
 static inline i32 buf_cmp(const void* a, const void* b, usize len)
@@ -166,7 +205,7 @@ static inline i32 buf_cmp(const void* a, const void* b, usize len)
 }
 static inline void buf_set(void* dst, u8 value, usize len)
 {
-    while (len--) ((u8*)dst)[len] = value;
+    memset(dst, value, len);
 }
 
 #define SLICE(type)                struct { type* start; type* end; }
@@ -471,6 +510,7 @@ thread_local u32 _format_buf_len;
 #define mrw_format(f, allocator, ...)\
 (\
     _format_buf_len = print(0, 0, f, __VA_ARGS__),\
+    _mrw_here(),\
     _format_buf.start = _mrw_alloc((Allocator*)allocator, _format_buf_len + 1, 1),\
     (void)print((char*)_format_buf.start, _format_buf_len, f, __VA_ARGS__),\
     _format_buf.end = _format_buf.start + _format_buf_len,\
@@ -539,6 +579,33 @@ static u64 u64_nextpow2(u64 x) {
   return x + 1;
 }
 
+// floor(log2(x)), x must not be 0
+static inline u32 u64_log2(u64 x) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long i; _BitScanReverse64(&i, x); return (u32)i;
+#else
+    return 63 - (u32)__builtin_clzll(x);
+#endif
+}
+
+// index of the lowest set bit, x must not be 0
+static inline u32 u64_ctz(u64 x) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long i; _BitScanForward64(&i, x); return (u32)i;
+#else
+    return (u32)__builtin_ctzll(x);
+#endif
+}
+
+// hint that p is about to be read, does nothing where theres no builtin for it
+static inline void mrw_prefetch(const void* p) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(p);
+#else
+    (void)p;
+#endif
+}
+
 static inline void* ptr_align_up(void* x, size_t a) {
     return (void*)(((usize)x + (a-1)) & ~(uintptr_t)(a-1));
 }
@@ -0,0 +1,332 @@
+#ifndef MARROW_PARALLEL_H
+#define MARROW_PARALLEL_H
+
+#include <stdatomic.h>
+
+#include "marrow.h"
+#include "alloc.h"
+#include "sort.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif // _WIN32
+
+// thread pool for fork join style loops, mrw_thread_pool_run hands out task indices [0, n_tasks) to the
+// workers and the calling thread and returns once all of them ran
+//
+//   ThreadPool pool; mrw_thread_pool_init(&pool, 8, nullptr);
+//   mrw_thread_pool_run(&pool, do_chunk, &ctx, 64);
+//   mrw_thread_pool_free(&pool);
+
+#ifndef MRW_PARALLEL_MAX_CHUNKS
+#define MRW_PARALLEL_MAX_CHUNKS 256
+#endif // MRW_PARALLEL_MAX_CHUNKS
+
+// below this many items the parallel algorithms just run on the calling thread
+#ifndef MRW_PARALLEL_MIN_ITEMS
+#define MRW_PARALLEL_MIN_ITEMS 4096
+#endif // MRW_PARALLEL_MIN_ITEMS
+
+typedef void (*ThreadPoolTask)(void* ctx, u32 task);
+
+// just what the pool needs from the platform, c11 threads arent there on msvc and older mingw
+#ifdef _WIN32
+typedef HANDLE _MrwThread;
+typedef SRWLOCK _MrwMutex;
+typedef CONDITION_VARIABLE _MrwCond;
+
+static inline void _mrw_mutex_init(_MrwMutex* m) { InitializeSRWLock(m); }
+static inline void _mrw_mutex_destroy(_MrwMutex* m) {}
+static inline void _mrw_mutex_lock(_MrwMutex* m) { AcquireSRWLockExclusive(m); }
+static inline void _mrw_mutex_unlock(_MrwMutex* m) { ReleaseSRWLockExclusive(m); }
+static inline void _mrw_cond_init(_MrwCond* c) { InitializeConditionVariable(c); }
+static inline void _mrw_cond_destroy(_MrwCond* c) {}
+static inline void _mrw_cond_wait(_MrwCond* c, _MrwMutex* m) { SleepConditionVariableSRW(c, m, INFINITE, 0); }
+static inline void _mrw_cond_signal(_MrwCond* c) { WakeConditionVariable(c); }
+static inline void _mrw_cond_broadcast(_MrwCond* c) { WakeAllConditionVariable(c); }
+#else
+typedef pthread_t _MrwThread;
+typedef pthread_mutex_t _MrwMutex;
+typedef pthread_cond_t _MrwCond;
+
+static inline void _mrw_mutex_init(_MrwMutex* m) { pthread_mutex_init(m, nullptr); }
+static inline void _mrw_mutex_destroy(_MrwMutex* m) { pthread_mutex_destroy(m); }
+static inline void _mrw_mutex_lock(_MrwMutex* m) { pthread_mutex_lock(m); }
+static inline void _mrw_mutex_unlock(_MrwMutex* m) { pthread_mutex_unlock(m); }
+static inline void _mrw_cond_init(_MrwCond* c) { pthread_cond_init(c, nullptr); }
+static inline void _mrw_cond_destroy(_MrwCond* c) { pthread_cond_destroy(c); }
+static inline void _mrw_cond_wait(_MrwCond* c, _MrwMutex* m) { pthread_cond_wait(c, m); }
+static inline void _mrw_cond_signal(_MrwCond* c) { pthread_cond_signal(c); }
+static inline void _mrw_cond_broadcast(_MrwCond* c) { pthread_cond_broadcast(c); }
+#endif // _WIN32
+
+typedef struct ThreadPool {
+    _MrwThread* threads;
+    u32 n_threads; // including the calling thread, workers is n_threads - 1
+    Allocator* allocator;
+
+    _MrwMutex _lock;
+    _MrwCond _wake;
+    _MrwCond _done;
+    u64 _generation;
+    u32 _working;
+    bool _quit;
+
+    ThreadPoolTask _task;
+    void* _ctx;
+    u32 _n_tasks;
+    atomic_uint _next_task;
+} ThreadPool;
+
+static inline void _mrw_thread_pool_work(ThreadPool* pool) {
+    for (u32 task; (task = atomic_fetch_add_explicit(&pool->_next_task, 1, memory_order_relaxed)) < pool->_n_tasks;)
+        pool->_task(pool->_ctx, task);
+}
+
+static inline void _mrw_thread_pool_worker(ThreadPool* pool) {
+    u64 seen = 0;
+    _mrw_mutex_lock(&pool->_lock);
+    loop {
+        while (pool->_generation == seen && !pool->_quit) _mrw_cond_wait(&pool->_wake, &pool->_lock);
+        if (pool->_quit) break;
+        seen = pool->_generation;
+        _mrw_mutex_unlock(&pool->_lock);
+
+        _mrw_thread_pool_work(pool);
+
+        _mrw_mutex_lock(&pool->_lock);
+        if (--pool->_working == 0) _mrw_cond_signal(&pool->_done);
+    }
+    _mrw_mutex_unlock(&pool->_lock);
+    mrw_scratch_release();
+}
+
+#ifdef _WIN32
+static DWORD WINAPI _mrw_thread_pool_entry(LPVOID arg) { _mrw_thread_pool_worker((ThreadPool*)arg); return 0; }
+
+static inline bool _mrw_thread_start(_MrwThread* t, ThreadPool* pool) { return (*t = CreateThread(nullptr, 0, _mrw_thread_pool_entry, pool, 0, nullptr)) != nullptr; }
+static inline void _mrw_thread_join(_MrwThread t) { WaitForSingleObject(t, INFINITE); CloseHandle(t); }
+#else
+static void* _mrw_thread_pool_entry(void* arg) { _mrw_thread_pool_worker((ThreadPool*)arg); return nullptr; }
+
+static inline bool _mrw_thread_start(_MrwThread* t, ThreadPool* pool) { return pthread_create(t, nullptr, _mrw_thread_pool_entry, pool) == 0; }
+static inline void _mrw_thread_join(_MrwThread t) { pthread_join(t, nullptr); }
+#endif // _WIN32
+
+static inline void mrw_thread_pool_init(ThreadPool* pool, u32 n_threads, Allocator* allocator) {
+    *pool = (ThreadPool){ .n_threads = max(n_threads, 1u), .allocator = allocator };
+    _mrw_mutex_init(&pool->_lock);
+    _mrw_cond_init(&pool->_wake);
+    _mrw_cond_init(&pool->_done);
+    if (pool->n_threads == 1) return;
+    pool->threads = mrw_alloc_n(allocator, _MrwThread, pool->n_threads - 1);
+    for (u32 i = 0; i < pool->n_threads - 1; i++)
+        if (!_mrw_thread_start(&pool->threads[i], pool)) mrw_abort("couldnt start thread pool worker");
+}
+
+static inline void mrw_thread_pool_free(ThreadPool* pool) {
+    _mrw_mutex_lock(&pool->_lock);
+    pool->_quit = true;
+    _mrw_cond_broadcast(&pool->_wake);
+    _mrw_mutex_unlock(&pool->_lock);
+    for (u32 i = 0; i + 1 < pool->n_threads; i++) _mrw_thread_join(pool->threads[i]);
+    if (pool->threads) _mrw_free(pool->allocator, pool->threads, (pool->n_threads - 1) * sizeof(_MrwThread));
+    _mrw_cond_destroy(&pool->_done);
+    _mrw_cond_destroy(&pool->_wake);
+    _mrw_mutex_destroy(&pool->_lock);
+    *pool = (ThreadPool){ 0 };
+}
+
+// not reentrant, tasks cant run more work on the same pool
+static inline void mrw_thread_pool_run(ThreadPool* pool, ThreadPoolTask task, void* ctx, u32 n_tasks) {
+    if (pool->n_threads == 1 || n_tasks == 1) {
+        for (u32 i = 0; i < n_tasks; i++) task(ctx, i);
+        return;
+    }
+    _mrw_mutex_lock(&pool->_lock);
+    pool->_task = task;
+    pool->_ctx = ctx;
+    pool->_n_tasks = n_tasks;
+    atomic_store_explicit(&pool->_next_task, 0, memory_order_relaxed);
+    pool->_working = pool->n_threads - 1;
+    pool->_generation++;
+    _mrw_cond_broadcast(&pool->_wake);
+    _mrw_mutex_unlock(&pool->_lock);
+
+    _mrw_thread_pool_work(pool);
+
+    _mrw_mutex_lock(&pool->_lock);
+    while (pool->_working) _mrw_cond_wait(&pool->_done, &pool->_lock);
+    _mrw_mutex_unlock(&pool->_lock);
+}
+
+// splits n items into n_chunks near equal ranges, chunk i is [_parallel_chunk(n, k, i), _parallel_chunk(n, k, i + 1))
+static inline u64 _parallel_chunk(u64 n, u32 n_chunks, u32 chunk) {
+    return n / n_chunks * chunk + n % n_chunks * chunk / n_chunks;
+}
+
+static inline u32 _parallel_n_chunks(ThreadPool* pool, u64 n) {
+    if (n < MRW_PARALLEL_MIN_ITEMS) return 1;
+    return min(pool->n_threads, (u32)MRW_PARALLEL_MAX_CHUNKS);
+}
+
+typedef struct { u8* dst; const u8* src; usize bytes; u32 n_chunks; } _ParallelCopy;
+
+static void _parallel_copy_task(void* ctx, u32 task) {
+    _ParallelCopy* c = (_ParallelCopy*)ctx;
+    usize from = _parallel_chunk(c->bytes, c->n_chunks, task), to = _parallel_chunk(c->bytes, c->n_chunks, task + 1);
+    buf_copy(c->dst + from, c->src + from, to - from);
+}
+
+static inline void mrw_parallel_copy(ThreadPool* pool, void* dst, const void* src, usize bytes) {
+    _ParallelCopy c = { (u8*)dst, (const u8*)src, bytes, _parallel_n_chunks(pool, bytes / 64) };
+    mrw_thread_pool_run(pool, _parallel_copy_task, &c, c.n_chunks);
+}
+
+// inclusive prefix sums, out can be items. every chunk sums its range, the chunk totals get scanned
+// on the calling thread and then every chunk scans its range again starting from its offset
+#define _MRW_PARALLEL_SCAN_DEFINE(T) \
+typedef struct { T* out; const T* items; u64 n; u32 n_chunks; T sums[MRW_PARALLEL_MAX_CHUNKS]; } _ParallelScan_##T; \
+static void _parallel_sum_task_##T(void* ctx, u32 task) { \
+    _ParallelScan_##T* c = (_ParallelScan_##T*)ctx; \
+    T sum = 0; \
+    for (u64 i = _parallel_chunk(c->n, c->n_chunks, task), end = _parallel_chunk(c->n, c->n_chunks, task + 1); i < end; i++) sum += c->items[i]; \
+    c->sums[task] = sum; \
+} \
+static void _parallel_scan_task_##T(void* ctx, u32 task) { \
+    _ParallelScan_##T* c = (_ParallelScan_##T*)ctx; \
+    T sum = c->sums[task]; \
+    for (u64 i = _parallel_chunk(c->n, c->n_chunks, task), end = _parallel_chunk(c->n, c->n_chunks, task + 1); i < end; i++) \
+        c->out[i] = sum += c->items[i]; \
+} \
+static inline void prefix_sum_parallel_##T(T* out, const T* items, u64 n, ThreadPool* pool) { \
+    _ParallelScan_##T c = { .out = out, .items = items, .n = n, .n_chunks = _parallel_n_chunks(pool, n) }; \
+    if (c.n_chunks > 1) { \
+        mrw_thread_pool_run(pool, _parallel_sum_task_##T, &c, c.n_chunks); \
+        T offset = 0; \
+        for (u32 i = 0; i < c.n_chunks; i++) { T sum = c.sums[i]; c.sums[i] = offset; offset += sum; } \
+    } \
+    else c.sums[0] = 0; \
+    mrw_thread_pool_run(pool, _parallel_scan_task_##T, &c, c.n_chunks); \
+}
+
+_MRW_PARALLEL_SCAN_DEFINE(u32)
+_MRW_PARALLEL_SCAN_DEFINE(u64)
+_MRW_PARALLEL_SCAN_DEFINE(i32)
+_MRW_PARALLEL_SCAN_DEFINE(i64)
+_MRW_PARALLEL_SCAN_DEFINE(f32)
+_MRW_PARALLEL_SCAN_DEFINE(f64)
+
+#define slice_prefix_sum_parallel(out, s, pool) _Generic(slice_start((s)), \
+    u32*: prefix_sum_parallel_u32, u64*: prefix_sum_parallel_u64, i32*: prefix_sum_parallel_i32, \
+    i64*: prefix_sum_parallel_i64, f32*: prefix_sum_parallel_f32, f64*: prefix_sum_parallel_f64) \
+    ((out), slice_start((s)), slice_count((s)), (pool))
+
+// the sort and partition need their comparison inlined into the task functions, so theyre defined
+// per type like SOA_VEKTOR
+//
+//   PARALLEL_SORT_DEFINE(sort_entities, Entity, a->depth < b->depth)
+//   sort_entities(items, n, &pool, allocator);
+
+// every chunk gets pdqsorted on its own, then log2(chunks) rounds of pairwise merges. each merge is
+// split into equal output pieces (merge path) so all threads stay busy until the last round
+#define PARALLEL_SORT_DEFINE(name, T, cmp) \
+typedef struct { T* items; T* from; T* to; u64 n; u32 n_chunks; u32 width; u32 pieces; } _##name##_ParallelSort; \
+static void _##name##_sort_task(void* ctx, u32 task) { \
+    _##name##_ParallelSort* c = (_##name##_ParallelSort*)ctx; \
+    T *a, *b; \
+    u64 from = _parallel_chunk(c->n, c->n_chunks, task), to = _parallel_chunk(c->n, c->n_chunks, task + 1); \
+    _mrw_pdqsort(T, c->items + from, to - from, _SORT_LESS, cmp); \
+} \
+static void _##name##_merge_task(void* ctx, u32 task) { \
+    _##name##_ParallelSort* c = (_##name##_ParallelSort*)ctx; \
+    T *a, *b; \
+    u32 pair = task / c->pieces, piece = task % c->pieces; \
+    u64 lo = _parallel_chunk(c->n, c->n_chunks, min(pair * 2 * c->width, c->n_chunks)); \
+    u64 mid = _parallel_chunk(c->n, c->n_chunks, min(pair * 2 * c->width + c->width, c->n_chunks)); \
+    u64 hi = _parallel_chunk(c->n, c->n_chunks, min(pair * 2 * c->width + 2 * c->width, c->n_chunks)); \
+    T* left = c->from + lo; T* right = c->from + mid; \
+    u64 n_left = mid - lo, n_right = hi - mid; \
+    u64 k[2] = { _parallel_chunk(hi - lo, c->pieces, piece), _parallel_chunk(hi - lo, c->pieces, piece + 1) }; \
+    u64 i[2], j[2]; \
+    for (u32 e = 0; e < 2; e++) { \
+        /* first i where taking one more from the left would break the merge order */ \
+        u64 l = k[e] > n_right ? k[e] - n_right : 0, h = min(k[e], n_left); \
+        while (l < h) { \
+            u64 m = (l + h) / 2; \
+            if (!_SORT_LESS(cmp, right + (k[e] - m - 1), left + m)) l = m + 1; \
+            else h = m; \
+        } \
+        i[e] = l; j[e] = k[e] - l; \
+    } \
+    T* out = c->to + lo + k[0]; \
+    u64 li = i[0], ri = j[0]; \
+    while (li < i[1] && ri < j[1]) *out++ = _SORT_LESS(cmp, right + ri, left + li) ? right[ri++] : left[li++]; \
+    while (li < i[1]) *out++ = left[li++]; \
+    while (ri < j[1]) *out++ = right[ri++]; \
+} \
+static inline void name(T* items, u64 n, ThreadPool* pool, Allocator* allocator) { \
+    u32 n_chunks = _parallel_n_chunks(pool, n); \
+    if (n_chunks == 1) { \
+        T *a, *b; \
+        _mrw_pdqsort(T, items, n, _SORT_LESS, cmp); \
+        return; \
+    } \
+    _##name##_ParallelSort c = { .items = items, .from = items, .n = n, .n_chunks = n_chunks }; \
+    mrw_thread_pool_run(pool, _##name##_sort_task, &c, n_chunks); \
+    _mrw_here(); \
+    T* buf = (T*)_mrw_alloc(allocator, n * sizeof(T), alignof(T)); \
+    c.to = buf; \
+    for (c.width = 1; c.width < n_chunks; c.width *= 2) { \
+        u32 pairs = (n_chunks + 2 * c.width - 1) / (2 * c.width); \
+        c.pieces = max(pool->n_threads / pairs, 1u); \
+        mrw_thread_pool_run(pool, _##name##_merge_task, &c, pairs * c.pieces); \
+        T* t = c.from; c.from = c.to; c.to = t; \
+    } \
+    if (c.from != items) mrw_parallel_copy(pool, items, c.from, n * sizeof(T)); \
+    _mrw_free(allocator, buf, n * sizeof(T)); \
+}
+
+// stable partition in place, items where pred (an expression over a, a T*) is true go first.
+// returns how many of them there are
+#define PARALLEL_PARTITION_DEFINE(name, T, pred) \
+typedef struct { T* items; T* buf; u64 n; u32 n_chunks; u64 offsets[MRW_PARALLEL_MAX_CHUNKS][2]; } _##name##_ParallelPartition; \
+static void _##name##_count_task(void* ctx, u32 task) { \
+    _##name##_ParallelPartition* c = (_##name##_ParallelPartition*)ctx; \
+    u64 count = 0; \
+    for (u64 i = _parallel_chunk(c->n, c->n_chunks, task), end = _parallel_chunk(c->n, c->n_chunks, task + 1); i < end; i++) { \
+        T* a = c->items + i; \
+        count += (pred) ? 1 : 0; \
+    } \
+    c->offsets[task][0] = count; \
+} \
+static void _##name##_scatter_task(void* ctx, u32 task) { \
+    _##name##_ParallelPartition* c = (_##name##_ParallelPartition*)ctx; \
+    u64 yes = c->offsets[task][0], no = c->offsets[task][1]; \
+    for (u64 i = _parallel_chunk(c->n, c->n_chunks, task), end = _parallel_chunk(c->n, c->n_chunks, task + 1); i < end; i++) { \
+        T* a = c->items + i; \
+        c->buf[(pred) ? yes++ : no++] = *a; \
+    } \
+} \
+static inline u64 name(T* items, u64 n, ThreadPool* pool, Allocator* allocator) { \
+    if (n == 0) return 0; \
+    _mrw_here(); \
+    T* buf = (T*)_mrw_alloc(allocator, n * sizeof(T), alignof(T)); \
+    _##name##_ParallelPartition c = { .items = items, .buf = buf, .n = n, .n_chunks = _parallel_n_chunks(pool, n) }; \
+    mrw_thread_pool_run(pool, _##name##_count_task, &c, c.n_chunks); \
+    u64 n_true = 0; \
+    for (u32 i = 0; i < c.n_chunks; i++) n_true += c.offsets[i][0]; \
+    for (u64 i = 0, yes = 0, no = n_true; i < c.n_chunks; i++) { \
+        u64 count = c.offsets[i][0]; \
+        c.offsets[i][0] = yes; c.offsets[i][1] = no; \
+        yes += count; no += _parallel_chunk(n, c.n_chunks, i + 1) - _parallel_chunk(n, c.n_chunks, i) - count; \
+    } \
+    mrw_thread_pool_run(pool, _##name##_scatter_task, &c, c.n_chunks); \
+    mrw_parallel_copy(pool, items, buf, n * sizeof(T)); \
+    _mrw_free(allocator, buf, n * sizeof(T)); \
+    return n_true; \
+}
+
+#endif // MARROW_PARALLEL_H
@@ -0,0 +1,135 @@
+#ifndef MARROW_SOA_H
+#define MARROW_SOA_H
+
+#include "marrow.h"
+#include "alloc.h"
+
+// struct of arrays vektor, every field gets its own contiguous column so loops that only touch
+// a couple of fields dont drag the rest through the cache
+//
+//   SOA_VEKTOR(Particles, (v2, pos), (v2, vel), (f32, life));
+//   Particles p; Particles_init(&p, 0, nullptr);
+//   Particles_add(&p, (ParticlesItem){ .life = 1.0f });
+//   for (u64 i = 0; i < p.n_items; i++) p.life[i] -= dt;
+//
+// all columns live in one allocation, each starting on an MRW_SOA_ALIGN boundary. the functions
+// dont record a callsite, their allocations show up under "unknown" in track.h
+
+#ifndef MRW_SOA_ALIGN
+#define MRW_SOA_ALIGN 64
+#endif // MRW_SOA_ALIGN
+
+static inline usize _soa_column_bytes(u32 item_size, u64 size) {
+    return ((usize)item_size * size + MRW_SOA_ALIGN - 1) & ~(usize)(MRW_SOA_ALIGN - 1);
+}
+
+static inline usize _soa_block_bytes(const u32 *sizes, u32 n_columns, u64 size) {
+    usize bytes = 0;
+    for (u32 i = 0; i < n_columns; i++)
+        bytes += _soa_column_bytes(sizes[i], size);
+    return bytes;
+}
+
+// moves every column into a fresh block of new_size rows, the first column is the block itself
+static inline void _soa_resize(u8 **columns, const u32 *sizes, u32 n_columns, u64 *size, u64 *n_items, u64 new_size, Allocator *a) {
+    if (new_size == *size) return;
+
+    u8* old = columns[0];
+    usize old_bytes = _soa_block_bytes(sizes, n_columns, *size);
+    *n_items = min(*n_items, new_size);
+
+    u8* block = new_size ? (u8*)_mrw_alloc(a, _soa_block_bytes(sizes, n_columns, new_size), MRW_SOA_ALIGN) : nullptr;
+    u8* column = block;
+    for (u32 i = 0; i < n_columns; i++) {
+        if (column) {
+            if (columns[i]) buf_copy(column, columns[i], *n_items * sizes[i]);
+            buf_set(column + *n_items * sizes[i], 0, (new_size - *n_items) * sizes[i]);
+        }
+        columns[i] = column;
+        if (column) column += _soa_column_bytes(sizes[i], new_size);
+    }
+    if (old) _mrw_free(a, old, old_bytes);
+    *size = new_size;
+}
+
+// makes sure new_size is a valid index
+static inline void _soa_ensure(u8 **columns, const u32 *sizes, u32 n_columns, u64 *size, u64 *n_items, u64 new_size, Allocator *a) {
+    if (new_size < *size) return;
+    _soa_resize(columns, sizes, n_columns, size, n_items, u64_nextpow2(new_size), a);
+}
+
+static inline void _soa_remove(u8 **columns, const u32 *sizes, u32 n_columns, u64 *n_items, u64 position) {
+    if (position >= *n_items) return;
+    for (u32 i = 0; i < n_columns; i++)
+        buf_move(columns[i] + position * sizes[i], columns[i] + (position + 1) * sizes[i], (*n_items - position - 1) * sizes[i]);
+    (*n_items)--;
+}
+
+// O(1), moves the last row into the hole so order isnt kept
+static inline void _soa_remove_swap(u8 **columns, const u32 *sizes, u32 n_columns, u64 *n_items, u64 position) {
+    if (position >= *n_items) return;
+    if (position == --*n_items) return;
+    for (u32 i = 0; i < n_columns; i++)
+        buf_copy(columns[i] + position * sizes[i], columns[i] + *n_items * sizes[i], sizes[i]);
+}
+
+#define _SOA_ITEM_FIELD(field) _SOA_ITEM_FIELD_ field
+#define _SOA_ITEM_FIELD_(type, name) type name;
+#define _SOA_COLUMN(field) _SOA_COLUMN_ field
+#define _SOA_COLUMN_(type, name) type* name;
+#define _SOA_SIZE(field) _SOA_SIZE_ field
+#define _SOA_SIZE_(type, name) sizeof(type),
+#define _SOA_SET(field) _SOA_SET_ field
+#define _SOA_SET_(type, name) v->name[index] = item.name;
+#define _SOA_GET(field) _SOA_GET_ field
+#define _SOA_GET_(type, name) item.name = v->name[index];
+
+// fields are (type, name) pairs, defines Name, NameItem (one row as a plain struct) and the Name_* functions
+#define SOA_VEKTOR(Name, ...) \
+typedef struct Name##Item { MRW_FOR_EACH(_SOA_ITEM_FIELD, __VA_ARGS__) } Name##Item; \
+typedef struct Name { \
+    union { \
+        struct { MRW_FOR_EACH(_SOA_COLUMN, __VA_ARGS__) }; \
+        u8* _columns[MRW_NARGS(__VA_ARGS__)]; \
+    }; \
+    u64 n_items; \
+    u64 size; \
+    Allocator* _allocator; \
+} Name; \
+static const u32 _##Name##_sizes[] = { MRW_FOR_EACH(_SOA_SIZE, __VA_ARGS__) }; \
+static inline void Name##_ensure(Name *v, u64 new_size) { \
+    _soa_ensure(v->_columns, _##Name##_sizes, array_len(_##Name##_sizes), &v->size, &v->n_items, new_size, v->_allocator); \
+} \
+static inline void Name##_reserve(Name *v, u64 count) { \
+    if (count > v->size) _soa_resize(v->_columns, _##Name##_sizes, array_len(_##Name##_sizes), &v->size, &v->n_items, count, v->_allocator); \
+} \
+static inline void Name##_init(Name *v, u64 initial_size, Allocator *allocator) { \
+    *v = (Name){ ._allocator = allocator }; \
+    Name##_ensure(v, initial_size); \
+} \
+static inline void Name##_free(Name *v) { \
+    _soa_resize(v->_columns, _##Name##_sizes, array_len(_##Name##_sizes), &v->size, &v->n_items, 0, v->_allocator); \
+} \
+static inline void Name##_clear(Name *v) { v->n_items = 0; } \
+static inline void Name##_set(Name *v, u64 index, Name##Item item) { MRW_FOR_EACH(_SOA_SET, __VA_ARGS__) } \
+static inline Name##Item Name##_get(Name *v, u64 index) { \
+    Name##Item item; \
+    MRW_FOR_EACH(_SOA_GET, __VA_ARGS__) \
+    return item; \
+} \
+static inline u64 Name##_add(Name *v, Name##Item item) { \
+    Name##_ensure(v, v->n_items); \
+    Name##_set(v, v->n_items, item); \
+    return v->n_items++; \
+} \
+static inline void Name##_remove(Name *v, u64 index) { \
+    _soa_remove(v->_columns, _##Name##_sizes, array_len(_##Name##_sizes), &v->n_items, index); \
+} \
+static inline void Name##_remove_swap(Name *v, u64 index) { \
+    _soa_remove_swap(v->_columns, _##Name##_sizes, array_len(_##Name##_sizes), &v->n_items, index); \
+}
+
+// one column as a slice, for the simd loops
+#define soa_column(v, field) slice_to((v).field, (v).n_items)
+
+#endif // MARROW_SOA_H
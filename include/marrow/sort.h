@@ -0,0 +1,316 @@
+#ifndef MARROW_SORT_H
+#define MARROW_SORT_H
+
+#include "marrow.h"
+#include "alloc.h"
+
+// comparison sorts take cmp as an expression over a and b (both T*) thats true when a goes before b,
+// same as sort_indices, and get inlined at the call site
+//
+//   slice_sort(s, Entity, a->depth < b->depth);
+//   slice_sort_stable(s, Entity, a->layer < b->layer, allocator);
+//   slice_sort_indices(order, s, Entity, a->depth < b->depth);
+//
+// slice_sort is a pattern defeating quicksort, unstable, in place, O(n log n) worst case
+// slice_sort_stable is a bottom up merge sort with a scratch buffer from the allocator
+// slice_radix_sort sorts integer and float slices by value with an lsd radix sort
+
+#define _MRW_SORT_INSERTION_THRESHOLD 24
+#define _MRW_SORT_NINTHER_THRESHOLD 128
+#define _MRW_SORT_MERGE_RUN 16
+
+#define _SORT_LESS(cmp, x, y) (a = (x), b = (y), (cmp))
+#define _SORT_LESS_INDEX(cmp, x, y) (a = _sort_keys + *(x), b = _sort_keys + *(y), (cmp))
+
+#define _sort_swap(E, x, y) do { E _sort_t = *(x); *(x) = *(y); *(y) = _sort_t; } while (0)
+#define _sort_sort2(E, LESS, cmp, x, y) do { if (LESS(cmp, (y), (x))) _sort_swap(E, (x), (y)); } while (0)
+#define _sort_sort3(E, LESS, cmp, x, y, z) do { \
+    _sort_sort2(E, LESS, cmp, (x), (y)); _sort_sort2(E, LESS, cmp, (y), (z)); _sort_sort2(E, LESS, cmp, (x), (y)); \
+} while (0)
+
+// stable, ok is set to false and the sort stops once it had to move more than 8 items
+#define _sort_insertion_limited(E, LESS, cmp, lo, hi, limit, ok) do { \
+    u64 _sort_moved = 0; ok = true; \
+    for (E* _sort_cur = (lo) + 1; _sort_cur < (hi); _sort_cur++) { \
+        if (!LESS(cmp, _sort_cur, _sort_cur - 1)) continue; \
+        E _sort_tmp = *_sort_cur; E* _sort_sift = _sort_cur; \
+        do { *_sort_sift = *(_sort_sift - 1); _sort_sift--; } \
+        while (_sort_sift != (lo) && LESS(cmp, &_sort_tmp, _sort_sift - 1)); \
+        *_sort_sift = _sort_tmp; \
+        _sort_moved += (u64)(_sort_cur - _sort_sift); \
+        if (_sort_moved > (limit)) { ok = false; break; } \
+    } \
+} while (0)
+
+#define _sort_insertion(E, LESS, cmp, lo, hi) do { \
+    bool _sort_unused_ok; \
+    _sort_insertion_limited(E, LESS, cmp, lo, hi, U64_MAX, _sort_unused_ok); \
+    mrw_unused _sort_unused_ok; \
+} while (0)
+
+#define _sort_sift_down(E, LESS, cmp, h, start, n) do { \
+    u64 _sort_root = (start); \
+    loop { \
+        u64 _sort_child = 2 * _sort_root + 1; \
+        if (_sort_child >= (n)) break; \
+        if (_sort_child + 1 < (n) && LESS(cmp, (h) + _sort_child, (h) + _sort_child + 1)) _sort_child++; \
+        if (!LESS(cmp, (h) + _sort_root, (h) + _sort_child)) break; \
+        _sort_swap(E, (h) + _sort_root, (h) + _sort_child); \
+        _sort_root = _sort_child; \
+    } \
+} while (0)
+
+#define _sort_heap(E, LESS, cmp, lo, hi) do { \
+    E* _sort_h = (lo); u64 _sort_hn = (u64)((hi) - (lo)); \
+    for (u64 _sort_k = _sort_hn / 2; _sort_k-- > 0;) _sort_sift_down(E, LESS, cmp, _sort_h, _sort_k, _sort_hn); \
+    for (u64 _sort_end = _sort_hn; _sort_end-- > 1;) { \
+        _sort_swap(E, _sort_h, _sort_h + _sort_end); \
+        _sort_sift_down(E, LESS, cmp, _sort_h, 0, _sort_end); \
+    } \
+} while (0)
+
+// pdqsort (orson peters), ranges are kept on an explicit stack, the larger half gets pushed and the
+// smaller one is sorted next so the stack never goes past log2(n) entries
+#define _mrw_pdqsort(E, items, count, LESS, cmp) do { \
+    E* _sort_los[64]; E* _sort_his[64]; u32 _sort_bads[64]; bool _sort_lefts[64]; u32 _sort_top = 0; \
+    u64 _sort_n = (count); \
+    if (_sort_n > 1) { \
+        _sort_los[0] = (items); _sort_his[0] = (items) + _sort_n; \
+        _sort_bads[0] = u64_log2(_sort_n); _sort_lefts[0] = true; _sort_top = 1; \
+    } \
+    while (_sort_top) { \
+        _sort_top--; \
+        E* _sort_lo = _sort_los[_sort_top]; E* _sort_hi = _sort_his[_sort_top]; \
+        u32 _sort_bad = _sort_bads[_sort_top]; bool _sort_leftmost = _sort_lefts[_sort_top]; \
+        loop { \
+            u64 _sort_size = (u64)(_sort_hi - _sort_lo); \
+            if (_sort_size < _MRW_SORT_INSERTION_THRESHOLD) { _sort_insertion(E, LESS, cmp, _sort_lo, _sort_hi); break; } \
+            /* pivot goes to lo, median of 3 or a ninther for big ranges */ \
+            u64 _sort_s2 = _sort_size / 2; \
+            if (_sort_size > _MRW_SORT_NINTHER_THRESHOLD) { \
+                _sort_sort3(E, LESS, cmp, _sort_lo, _sort_lo + _sort_s2, _sort_hi - 1); \
+                _sort_sort3(E, LESS, cmp, _sort_lo + 1, _sort_lo + _sort_s2 - 1, _sort_hi - 2); \
+                _sort_sort3(E, LESS, cmp, _sort_lo + 2, _sort_lo + _sort_s2 + 1, _sort_hi - 3); \
+                _sort_sort3(E, LESS, cmp, _sort_lo + _sort_s2 - 1, _sort_lo + _sort_s2, _sort_lo + _sort_s2 + 1); \
+                _sort_swap(E, _sort_lo, _sort_lo + _sort_s2); \
+            } \
+            else _sort_sort3(E, LESS, cmp, _sort_lo + _sort_s2, _sort_lo, _sort_hi - 1); \
+            E _sort_pivot_val = *_sort_lo; \
+            E* _sort_first = _sort_lo; E* _sort_last = _sort_hi; \
+            /* pivot equal to whatever is left of this range, put everything equal to it on the left and skip it */ \
+            if (!_sort_leftmost && !LESS(cmp, _sort_lo - 1, _sort_lo)) { \
+                while (LESS(cmp, &_sort_pivot_val, --_sort_last)); \
+                if (_sort_last + 1 == _sort_hi) while (_sort_first < _sort_last && !LESS(cmp, &_sort_pivot_val, ++_sort_first)); \
+                else while (!LESS(cmp, &_sort_pivot_val, ++_sort_first)); \
+                while (_sort_first < _sort_last) { \
+                    _sort_swap(E, _sort_first, _sort_last); \
+                    while (LESS(cmp, &_sort_pivot_val, --_sort_last)); \
+                    while (!LESS(cmp, &_sort_pivot_val, ++_sort_first)); \
+                } \
+                *_sort_lo = *_sort_last; *_sort_last = _sort_pivot_val; \
+                _sort_lo = _sort_last + 1; \
+                continue; \
+            } \
+            while (LESS(cmp, ++_sort_first, &_sort_pivot_val)); \
+            if (_sort_first - 1 == _sort_lo) while (_sort_first < _sort_last && !LESS(cmp, --_sort_last, &_sort_pivot_val)); \
+            else while (!LESS(cmp, --_sort_last, &_sort_pivot_val)); \
+            bool _sort_partitioned = _sort_first >= _sort_last; \
+            while (_sort_first < _sort_last) { \
+                _sort_swap(E, _sort_first, _sort_last); \
+                while (LESS(cmp, ++_sort_first, &_sort_pivot_val)); \
+                while (!LESS(cmp, --_sort_last, &_sort_pivot_val)); \
+            } \
+            E* _sort_pivot = _sort_first - 1; \
+            *_sort_lo = *_sort_pivot; *_sort_pivot = _sort_pivot_val; \
+            u64 _sort_l = (u64)(_sort_pivot - _sort_lo), _sort_r = (u64)(_sort_hi - _sort_pivot - 1); \
+            if (_sort_l < _sort_size / 8 || _sort_r < _sort_size / 8) { \
+                /* bad split, give up on quicksort after log2(n) of them, otherwise shuffle some items around */ \
+                if (--_sort_bad == 0) { _sort_heap(E, LESS, cmp, _sort_lo, _sort_hi); break; } \
+                if (_sort_l >= _MRW_SORT_INSERTION_THRESHOLD) { \
+                    _sort_swap(E, _sort_lo, _sort_lo + _sort_l / 4); \
+                    _sort_swap(E, _sort_pivot - 1, _sort_pivot - _sort_l / 4); \
+                    if (_sort_l > _MRW_SORT_NINTHER_THRESHOLD) { \
+                        _sort_swap(E, _sort_lo + 1, _sort_lo + (_sort_l / 4 + 1)); \
+                        _sort_swap(E, _sort_lo + 2, _sort_lo + (_sort_l / 4 + 2)); \
+                        _sort_swap(E, _sort_pivot - 2, _sort_pivot - (_sort_l / 4 + 1)); \
+                        _sort_swap(E, _sort_pivot - 3, _sort_pivot - (_sort_l / 4 + 2)); \
+                    } \
+                } \
+                if (_sort_r >= _MRW_SORT_INSERTION_THRESHOLD) { \
+                    _sort_swap(E, _sort_pivot + 1, _sort_pivot + (1 + _sort_r / 4)); \
+                    _sort_swap(E, _sort_hi - 1, _sort_hi - _sort_r / 4); \
+                    if (_sort_r > _MRW_SORT_NINTHER_THRESHOLD) { \
+                        _sort_swap(E, _sort_pivot + 2, _sort_pivot + (2 + _sort_r / 4)); \
+                        _sort_swap(E, _sort_pivot + 3, _sort_pivot + (3 + _sort_r / 4)); \
+                        _sort_swap(E, _sort_hi - 2, _sort_hi - (1 + _sort_r / 4)); \
+                        _sort_swap(E, _sort_hi - 3, _sort_hi - (2 + _sort_r / 4)); \
+                    } \
+                } \
+            } \
+            else if (_sort_partitioned) { \
+                /* nothing moved, the range is probably sorted already so try finishing it cheaply */ \
+                bool _sort_ok_l, _sort_ok_r = false; \
+                _sort_insertion_limited(E, LESS, cmp, _sort_lo, _sort_pivot, 8, _sort_ok_l); \
+                if (_sort_ok_l) _sort_insertion_limited(E, LESS, cmp, _sort_pivot + 1, _sort_hi, 8, _sort_ok_r); \
+                if (_sort_ok_l && _sort_ok_r) break; \
+            } \
+            if (_sort_l > _sort_r) { \
+                _sort_los[_sort_top] = _sort_lo; _sort_his[_sort_top] = _sort_pivot; \
+                _sort_bads[_sort_top] = _sort_bad; _sort_lefts[_sort_top] = _sort_leftmost; _sort_top++; \
+                _sort_lo = _sort_pivot + 1; _sort_leftmost = false; \
+            } \
+            else { \
+                _sort_los[_sort_top] = _sort_pivot + 1; _sort_his[_sort_top] = _sort_hi; \
+                _sort_bads[_sort_top] = _sort_bad; _sort_lefts[_sort_top] = false; _sort_top++; \
+                _sort_hi = _sort_pivot; \
+            } \
+        } \
+    } \
+} while (0)
+
+// insertion sorted runs, then merge passes bouncing between the items and the scratch buffer
+#define _mrw_mergesort(E, items, count, LESS, cmp, allocator) do { \
+    E* _sort_from = (items); u64 _sort_n = (count); \
+    if (_sort_n < 2) break; \
+    for (u64 _sort_run = 0; _sort_run < _sort_n; _sort_run += _MRW_SORT_MERGE_RUN) \
+        _sort_insertion(E, LESS, cmp, _sort_from + _sort_run, _sort_from + min(_sort_run + _MRW_SORT_MERGE_RUN, _sort_n)); \
+    if (_sort_n <= _MRW_SORT_MERGE_RUN) break; \
+    _mrw_here(); \
+    E* _sort_buf = (E*)_mrw_alloc((allocator), _sort_n * sizeof(E), alignof(E)); \
+    E* _sort_to = _sort_buf; \
+    for (u64 _sort_width = _MRW_SORT_MERGE_RUN; _sort_width < _sort_n; _sort_width *= 2) { \
+        for (u64 _sort_low = 0; _sort_low < _sort_n; _sort_low += 2 * _sort_width) { \
+            u64 _sort_mid = min(_sort_low + _sort_width, _sort_n), _sort_high = min(_sort_low + 2 * _sort_width, _sort_n); \
+            u64 _sort_i = _sort_low, _sort_j = _sort_mid, _sort_k = _sort_low; \
+            while (_sort_i < _sort_mid && _sort_j < _sort_high) \
+                _sort_to[_sort_k++] = LESS(cmp, _sort_from + _sort_j, _sort_from + _sort_i) ? _sort_from[_sort_j++] : _sort_from[_sort_i++]; \
+            buf_copy(_sort_to + _sort_k, _sort_from + _sort_i, (_sort_mid - _sort_i) * sizeof(E)); \
+            _sort_k += _sort_mid - _sort_i; \
+            buf_copy(_sort_to + _sort_k, _sort_from + _sort_j, (_sort_high - _sort_j) * sizeof(E)); \
+        } \
+        E* _sort_swap_tmp = _sort_from; _sort_from = _sort_to; _sort_to = _sort_swap_tmp; \
+    } \
+    if (_sort_from == _sort_buf) buf_copy(_sort_to, _sort_from, _sort_n * sizeof(E)); \
+    _mrw_free((allocator), _sort_buf, _sort_n * sizeof(E)); \
+} while (0)
+
+#define slice_sort(s, T, cmp) do { \
+    T* _sort_items = slice_start((s)); u64 _sort_count = slice_count((s)); \
+    T *a, *b; \
+    _mrw_pdqsort(T, _sort_items, _sort_count, _SORT_LESS, cmp); \
+} while (0)
+
+#define slice_sort_stable(s, T, cmp, allocator) do { \
+    T* _sort_items = slice_start((s)); u64 _sort_count = slice_count((s)); \
+    T *a, *b; \
+    _mrw_mergesort(T, _sort_items, _sort_count, _SORT_LESS, cmp, (allocator)); \
+} while (0)
+
+// out gets the u32 indices of s in sorted order, s itself isnt touched
+#define slice_sort_indices(out, s, T, cmp) do { \
+    u32* _sort_out = (out); T* _sort_keys = slice_start((s)); u64 _sort_count = slice_count((s)); \
+    for (u64 _sort_i = 0; _sort_i < _sort_count; _sort_i++) _sort_out[_sort_i] = (u32)_sort_i; \
+    T *a, *b; \
+    _mrw_pdqsort(u32, _sort_out, _sort_count, _SORT_LESS_INDEX, cmp); \
+} while (0)
+
+#define slice_sort_indices_stable(out, s, T, cmp, allocator) do { \
+    u32* _sort_out = (out); T* _sort_keys = slice_start((s)); u64 _sort_count = slice_count((s)); \
+    for (u64 _sort_i = 0; _sort_i < _sort_count; _sort_i++) _sort_out[_sort_i] = (u32)_sort_i; \
+    T *a, *b; \
+    _mrw_mergesort(u32, _sort_out, _sort_count, _SORT_LESS_INDEX, cmp, (allocator)); \
+} while (0)
+
+// lsd radix sort, one counting pass for all digits then a scatter per byte, bytes where every key
+// has the same value get skipped. values (optional) get carried along, its stable
+#define _MRW_RADIX_SORT_DEFINE(K) \
+static inline void _mrw_radix_sort_##K(K* keys, u32* values, u64 n, Allocator* allocator) { \
+    if (n < 2) return; \
+    u64 counts[sizeof(K)][256]; \
+    buf_set(counts, 0, sizeof(counts)); \
+    for (u64 i = 0; i < n; i++) \
+        for (u32 d = 0; d < sizeof(K); d++) counts[d][(keys[i] >> (d * 8)) & 0xff]++; \
+    _mrw_here(); \
+    K* keys_tmp = (K*)_mrw_alloc(allocator, n * sizeof(K), alignof(K)); \
+    u32* values_tmp = values ? (u32*)_mrw_alloc(allocator, n * sizeof(u32), alignof(u32)) : nullptr; \
+    K* src = keys; K* dst = keys_tmp; u32* vsrc = values; u32* vdst = values_tmp; \
+    for (u32 d = 0; d < sizeof(K); d++) { \
+        u32 shift = d * 8; \
+        if (counts[d][(src[0] >> shift) & 0xff] == n) continue; \
+        u64 offsets[256]; \
+        for (u64 sum = 0, i = 0; i < 256; i++) { offsets[i] = sum; sum += counts[d][i]; } \
+        if (values) for (u64 i = 0; i < n; i++) { \
+            u64 o = offsets[(src[i] >> shift) & 0xff]++; \
+            dst[o] = src[i]; vdst[o] = vsrc[i]; \
+        } \
+        else for (u64 i = 0; i < n; i++) dst[offsets[(src[i] >> shift) & 0xff]++] = src[i]; \
+        K* k = src; src = dst; dst = k; \
+        u32* v = vsrc; vsrc = vdst; vdst = v; \
+    } \
+    if (src != keys) { \
+        buf_copy(keys, src, n * sizeof(K)); \
+        if (values) buf_copy(values, vsrc, n * sizeof(u32)); \
+    } \
+    if (values) _mrw_free(allocator, values_tmp, n * sizeof(u32)); \
+    _mrw_free(allocator, keys_tmp, n * sizeof(K)); \
+}
+
+_MRW_RADIX_SORT_DEFINE(u32)
+_MRW_RADIX_SORT_DEFINE(u64)
+
+// signed and float keys get mapped onto unsigned ones that sort the same way
+static inline u32 _radix_key_i32(i32 x) { return (u32)x ^ 0x80000000u; }
+static inline u64 _radix_key_i64(i64 x) { return (u64)x ^ 0x8000000000000000ull; }
+static inline u32 _radix_key_f32(f32 x) { u32 u; buf_copy(&u, &x, sizeof(u)); return u ^ ((u >> 31) ? 0xffffffffu : 0x80000000u); }
+static inline u64 _radix_key_f64(f64 x) { u64 u; buf_copy(&u, &x, sizeof(u)); return u ^ ((u >> 63) ? ~0ull : 0x8000000000000000ull); }
+static inline i32 _radix_unkey_i32(u32 k) { return (i32)(k ^ 0x80000000u); }
+static inline i64 _radix_unkey_i64(u64 k) { return (i64)(k ^ 0x8000000000000000ull); }
+static inline f32 _radix_unkey_f32(u32 k) { k ^= (k >> 31) ? 0x80000000u : 0xffffffffu; f32 x; buf_copy(&x, &k, sizeof(x)); return x; }
+static inline f64 _radix_unkey_f64(u64 k) { k ^= (k >> 63) ? 0x8000000000000000ull : ~0ull; f64 x; buf_copy(&x, &k, sizeof(x)); return x; }
+
+static inline void radix_sort_u32(u32* items, u64 n, Allocator* allocator) { _mrw_radix_sort_u32(items, nullptr, n, allocator); }
+static inline void radix_sort_u64(u64* items, u64 n, Allocator* allocator) { _mrw_radix_sort_u64(items, nullptr, n, allocator); }
+
+#define _MRW_RADIX_SORT_MAPPED(T, K) \
+static inline void radix_sort_##T(T* items, u64 n, Allocator* allocator) { \
+    _mrw_here(); \
+    K* keys = (K*)_mrw_alloc(allocator, n * sizeof(K), alignof(K)); \
+    for (u64 i = 0; i < n; i++) keys[i] = _radix_key_##T(items[i]); \
+    _mrw_radix_sort_##K(keys, nullptr, n, allocator); \
+    for (u64 i = 0; i < n; i++) items[i] = _radix_unkey_##T(keys[i]); \
+    _mrw_free(allocator, keys, n * sizeof(K)); \
+}
+
+_MRW_RADIX_SORT_MAPPED(i32, u32)
+_MRW_RADIX_SORT_MAPPED(i64, u64)
+_MRW_RADIX_SORT_MAPPED(f32, u32)
+_MRW_RADIX_SORT_MAPPED(f64, u64)
+
+// out gets the indices of items in sorted order, stable
+#define _MRW_RADIX_SORT_INDICES(T, K, key) \
+static inline void radix_sort_indices_##T(u32* out, const T* items, u64 n, Allocator* allocator) { \
+    _mrw_here(); \
+    K* keys = (K*)_mrw_alloc(allocator, n * sizeof(K), alignof(K)); \
+    for (u64 i = 0; i < n; i++) { keys[i] = key(items[i]); out[i] = (u32)i; } \
+    _mrw_radix_sort_##K(keys, out, n, allocator); \
+    _mrw_free(allocator, keys, n * sizeof(K)); \
+}
+
+_MRW_RADIX_SORT_INDICES(u32, u32, (u32))
+_MRW_RADIX_SORT_INDICES(u64, u64, (u64))
+_MRW_RADIX_SORT_INDICES(i32, u32, _radix_key_i32)
+_MRW_RADIX_SORT_INDICES(i64, u64, _radix_key_i64)
+_MRW_RADIX_SORT_INDICES(f32, u32, _radix_key_f32)
+_MRW_RADIX_SORT_INDICES(f64, u64, _radix_key_f64)
+
+#define _radix_dispatch(s, name) _Generic(slice_start((s)), \
+    u32*: name##_u32, u64*: name##_u64, i32*: name##_i32, i64*: name##_i64, f32*: name##_f32, f64*: name##_f64)
+
+// ascending, nans end up wherever their bits put them
+#define slice_radix_sort(s, allocator) \
+    _radix_dispatch((s), radix_sort)(slice_start((s)), slice_count((s)), (allocator))
+
+#define slice_radix_sort_indices(out, s, allocator) \
+    _radix_dispatch((s), radix_sort_indices)((out), slice_start((s)), slice_count((s)), (allocator))
+
+#endif // MARROW_SORT_H
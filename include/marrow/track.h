@@ -0,0 +1,210 @@
+#ifndef MARROW_TRACK_H
+#define MARROW_TRACK_H
+
+#include "marrow.h"
+#include "alloc.h"
+#include "mapa.h"
+
+#include <inttypes.h>
+
+// wraps another allocator and keeps count of what goes through it, allocations are attributed to the
+// callsite recorded by mrw_alloc/mrw_alloc_n/mrw_realloc and the container macros, anything else
+// ends up under "unknown". callsites are only recorded with MRW_TRACK_CALLSITES defined before the
+// first marrow include, without it everything is "unknown". the bookkeeping itself lives in the
+// wrapped allocator
+#define MRW_TRACKING_HISTOGRAM_BUCKETS 48
+
+typedef struct {
+    cstr file;
+    u32 line;
+    u64 allocs;
+    u64 reallocs;
+    u64 bytes;      // total ever requested
+    u64 live_count;
+    u64 live_bytes;
+} TrackingCallsite;
+
+typedef struct {
+    usize size;
+    AllocCallsite callsite;
+} _TrackingLive;
+
+typedef struct {
+    Allocator _impl;
+    Allocator* allocator;
+
+    u64 allocs;
+    u64 reallocs;
+    u64 frees;
+    usize live_bytes;
+    usize peak_bytes;
+    u64 histogram[MRW_TRACKING_HISTOGRAM_BUCKETS]; // [i] counts allocations of 2^i up to 2^(i+1) - 1 bytes
+
+    bool _initialized;
+    MAPA(AllocCallsite, TrackingCallsite) callsites; // keyed on the file pointer and line
+    MAPA(void*, _TrackingLive) _live;
+} TrackingAllocator;
+#define MRW_TRACKING_IMPL ._impl = { .alloc = _mrw_tracking_alloc, .realloc = _mrw_tracking_realloc, .free = _mrw_tracking_free }
+
+static inline u64 _tracking_hash(const void* key, u64 key_size) { return hash_u64(*(u64*)key); }
+
+// fields one by one, the padding after line isnt initialized
+static inline u64 _tracking_callsite_hash(const void* key, u64 key_size)
+{
+    const AllocCallsite* site = (const AllocCallsite*)key;
+    return hash_combine((u64)(usize)site->file, site->line);
+}
+
+static inline u8 _tracking_callsite_cmp(const void* a, const void* b, u64 key_size)
+{
+    const AllocCallsite* x = (const AllocCallsite*)a;
+    const AllocCallsite* y = (const AllocCallsite*)b;
+    return x->file != y->file || x->line != y->line;
+}
+
+static inline void _tracking_init(TrackingAllocator* a)
+{
+    if (a->_initialized) return;
+    mapa_init(a->callsites, _tracking_callsite_hash, _tracking_callsite_cmp, a->allocator);
+    mapa_init(a->_live, _tracking_hash, mapa_cmp_bytes, a->allocator);
+    a->_initialized = true;
+}
+
+static inline TrackingCallsite* _tracking_callsite(TrackingAllocator* a, AllocCallsite* site)
+{
+    if (!site->file) site->file = "unknown";
+    TrackingCallsite* callsite = mapa_get(a->callsites, site);
+    if (!callsite) callsite = mapa_insert(a->callsites, site, ((TrackingCallsite){ .file = site->file, .line = site->line }));
+    return callsite;
+}
+
+// takes the recorded callsite so it doesnt leak into unrelated allocations,
+// the bookkeeping records its own so it gets cleared again once were done
+static inline AllocCallsite _tracking_take_callsite(void)
+{
+    AllocCallsite site = _mrw_callsite;
+    _mrw_callsite = (AllocCallsite){ 0 };
+    return site;
+}
+
+static inline void _tracking_add(TrackingAllocator* a, void* ptr, usize size, AllocCallsite site, TrackingCallsite* callsite)
+{
+    mapa_insert(a->_live, &ptr, ((_TrackingLive){ .size = size, .callsite = site }));
+    callsite->live_count++;
+    callsite->live_bytes += size;
+    callsite->bytes += size;
+    a->live_bytes += size;
+    a->peak_bytes = max(a->peak_bytes, a->live_bytes);
+    a->histogram[min(size ? u64_log2(size) : 0, MRW_TRACKING_HISTOGRAM_BUCKETS - 1)]++;
+}
+
+static inline void _tracking_remove(TrackingAllocator* a, void* ptr)
+{
+    _TrackingLive* live = mapa_get(a->_live, &ptr);
+    if (!live) return;
+    u64 index = _mapa_i;
+    TrackingCallsite* callsite = mapa_get(a->callsites, &live->callsite);
+    if (callsite) {
+        callsite->live_count--;
+        callsite->live_bytes -= live->size;
+    }
+    a->live_bytes -= live->size;
+    mapa_remove_at_index(a->_live, index);
+}
+
+static inline void* _mrw_tracking_alloc(Allocator* allocator, usize size, usize align)
+{
+    TrackingAllocator* a = (TrackingAllocator*)allocator;
+    AllocCallsite site = _tracking_take_callsite();
+    _tracking_init(a);
+    _tracking_callsite(a, &site)->allocs++;
+    a->allocs++;
+
+    void* ptr = _mrw_alloc(a->allocator, size, align);
+    _tracking_add(a, ptr, size, site, mapa_get(a->callsites, &site));
+    _mrw_callsite = (AllocCallsite){ 0 };
+    return ptr;
+}
+
+static inline void* _mrw_tracking_realloc(Allocator* allocator, void* ptr, usize old_size, usize new_size, usize align)
+{
+    TrackingAllocator* a = (TrackingAllocator*)allocator;
+    AllocCallsite site = _tracking_take_callsite();
+    _tracking_init(a);
+    _tracking_callsite(a, &site)->reallocs++;
+    a->reallocs++;
+
+    void* new_ptr = _mrw_realloc(a->allocator, ptr, old_size, new_size, align);
+    if (!new_ptr) return nullptr;
+    if (ptr) _tracking_remove(a, ptr);
+    _tracking_add(a, new_ptr, new_size, site, mapa_get(a->callsites, &site));
+    _mrw_callsite = (AllocCallsite){ 0 };
+    return new_ptr;
+}
+
+static inline void _mrw_tracking_free(Allocator* allocator, void* ptr, usize size)
+{
+    TrackingAllocator* a = (TrackingAllocator*)allocator;
+    _tracking_init(a);
+    a->frees++;
+    _tracking_remove(a, ptr);
+    _mrw_free(a->allocator, ptr, size);
+    _mrw_callsite = (AllocCallsite){ 0 };
+}
+
+static inline void _tracking_write_json_str(FILE* f, cstr s)
+{
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fprintf(f, "\\%c", *s);
+        else if ((u8)*s < 0x20) fprintf(f, "\\u%04x", (u8)*s);
+        else fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+// writes everything as json, callsites that still hold memory are listed again under "leaks"
+static inline void mrw_tracking_dump(TrackingAllocator* a, FILE* f)
+{
+    _tracking_init(a);
+    fprintf(f, "{\n\t\"allocs\": %" PRIu64 ",\n\t\"reallocs\": %" PRIu64 ",\n\t\"frees\": %" PRIu64 ",\n\t\"live_bytes\": %" PRIu64 ",\n\t\"peak_bytes\": %" PRIu64 ",\n",
+        a->allocs, a->reallocs, a->frees, (u64)a->live_bytes, (u64)a->peak_bytes);
+
+    fprintf(f, "\t\"histogram\": [");
+    bool first = true;
+    for (u32 i = 0; i < MRW_TRACKING_HISTOGRAM_BUCKETS; i++) {
+        if (!a->histogram[i]) continue;
+        fprintf(f, "%s\n\t\t{ \"size\": %" PRIu64 ", \"count\": %" PRIu64 " }", first ? "" : ",", (u64)1 << i, a->histogram[i]);
+        first = false;
+    }
+    fprintf(f, "\n\t],\n");
+
+    for (u32 leaks = 0; leaks < 2; leaks++) {
+        fprintf(f, "\t\"%s\": [", leaks ? "leaks" : "callsites");
+        first = true;
+        for (u64 i = 0; i < a->callsites.size; i++) {
+            if (!a->callsites.entries[i].has_value) continue;
+            TrackingCallsite* c = &a->callsites.entries[i].value;
+            if (leaks && !c->live_count) continue;
+            fprintf(f, "%s\n\t\t{ \"file\": ", first ? "" : ",");
+            _tracking_write_json_str(f, c->file);
+            fprintf(f, ", \"line\": %" PRIu32 ", \"allocs\": %" PRIu64 ", \"reallocs\": %" PRIu64
+                ", \"bytes\": %" PRIu64 ", \"live_count\": %" PRIu64 ", \"live_bytes\": %" PRIu64 " }",
+                c->line, c->allocs, c->reallocs, c->bytes, c->live_count, c->live_bytes);
+            first = false;
+        }
+        fprintf(f, "\n\t]%s\n", leaks ? "" : ",");
+    }
+    fprintf(f, "}\n");
+    push_stream(f);
+}
+
+static inline void mrw_tracking_free(TrackingAllocator* a)
+{
+    if (!a->_initialized) return;
+    mapa_free(a->callsites);
+    mapa_free(a->_live);
+    a->_initialized = false;
+}
+
+#endif // MARROW_TRACK_H
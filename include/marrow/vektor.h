@@ -4,6 +4,13 @@
 #include "marrow.h"
 #include "alloc.h"
 
+typedef enum VektorFlags {
+    VEKTOR_GROW_POW2 = 0,      // default, capacity goes to the next power of two
+    VEKTOR_GROW_1_5  = 1 << 0, // capacity grows by 1.5x
+    VEKTOR_NO_ZERO   = 1 << 1, // new capacity isnt zeroed, untouched pages stay uncommitted
+    _VEKTOR_INLINE   = 1 << 2, // items points at the inline storage of a VEKTOR_INLINE, dont free it
+} VektorFlags;
+
 #define VEKTOR(item)\
 struct \
 { \
@@ -11,17 +18,40 @@ struct \
     u64 n_items; \
     u64 size; \
     Allocator* _allocator; \
+    u32 _flags; \
+}
+
+// keeps up to n items inside the struct and only allocates once it outgrows them, items points
+// into the struct itself so it cant be copied around by value while its inline
+#define VEKTOR_INLINE(item, n)\
+struct \
+{ \
+    item* items; \
+    u64 n_items; \
+    u64 size; \
+    Allocator* _allocator; \
+    u32 _flags; \
+    item _inline[n]; \
 }
 
-#define vektor_init(v, initial_size, allocator) \
+#define vektor_init_flags(v, initial_size, allocator, flags) \
 do { \
-    v.size = 0; v.items = nullptr; v.n_items = 0; v._allocator = allocator; \
+    v.size = 0; v.items = nullptr; v.n_items = 0; v._allocator = allocator; v._flags = (flags); \
     vektor_ensure((v), (initial_size));\
 } while (0)
 
+#define vektor_init(v, initial_size, allocator) vektor_init_flags((v), (initial_size), (allocator), VEKTOR_GROW_POW2)
+
+#define vektor_init_inline(v, allocator) \
+do { \
+    v.items = v._inline; v.size = array_len(v._inline); v.n_items = 0; v._allocator = allocator; v._flags = _VEKTOR_INLINE; \
+    buf_set(v._inline, 0, sizeof(v._inline)); \
+} while (0)
+
 #define vektor_free(v) \
 do { \
-    _mrw_free(v._allocator, v.items, v.size * sizeof(*v.items)); \
+    if (!FLAG_HAS(v._flags, _VEKTOR_INLINE)) _mrw_free(v._allocator, v.items, v.size * sizeof(*v.items)); \
+    FLAG_CLEAR(v._flags, _VEKTOR_INLINE); \
     v.n_items = 0; v.size = 0; v.items = nullptr; \
 } while (0)
 
@@ -32,44 +62,199 @@ do { \
 
 #define vektor_add(v, ...) vektor_insert(v, v.n_items, __VA_ARGS__)
 
-static inline void _vektor_ensure(u8 **items, u64 *size, u64 new_size, u64 item_size, Allocator *a) {
-    if (new_size < *size) return;
-    new_size = u64_nextpow2(new_size);
-    *items = (u8*)(*items
-        ? _mrw_realloc(a, *items, *size * item_size, new_size * item_size, 1)
-        : _mrw_alloc(a, new_size * item_size, 1));
-    buf_set(*items + *size * item_size, 0, (new_size - *size) * item_size);
+// sets the capacity to exactly new_size, dropping items past it
+static inline void _vektor_resize(u8 **items, u64 *size, u64 *n_items, u64 new_size, u64 item_size, u64 item_align, Allocator *a, u32 *flags) {
+    if (new_size == *size) return;
+
+    // inline storage only ever spills onto the heap
+    if (FLAG_HAS(*flags, _VEKTOR_INLINE)) {
+        if (new_size < *size) return;
+        u8* heap = (u8*)_mrw_alloc(a, new_size * item_size, item_align);
+        buf_copy(heap, *items, *size * item_size);
+        *items = heap;
+        FLAG_CLEAR(*flags, _VEKTOR_INLINE);
+    }
+    else if (new_size == 0) {
+        _mrw_free(a, *items, *size * item_size);
+        *items = nullptr;
+        *size = *n_items = 0;
+        return;
+    }
+    else {
+        *items = (u8*)(*items
+            ? _mrw_realloc(a, *items, *size * item_size, new_size * item_size, item_align)
+            : _mrw_alloc(a, new_size * item_size, item_align));
+    }
+    if (!FLAG_HAS(*flags, VEKTOR_NO_ZERO) && new_size > *size)
+        buf_set(*items + *size * item_size, 0, (new_size - *size) * item_size);
     *size = new_size;
+    *n_items = min(*n_items, new_size);
+}
+
+// makes sure new_size is a valid index
+static inline void _vektor_ensure(u8 **items, u64 *size, u64 *n_items, u64 new_size, u64 item_size, u64 item_align, Allocator *a, u32 *flags) {
+    if (new_size < *size) return;
+    new_size = FLAG_HAS(*flags, VEKTOR_GROW_1_5) ? max(new_size + 1, *size + *size / 2) : u64_nextpow2(new_size);
+    _vektor_resize(items, size, n_items, new_size, item_size, item_align, a, flags);
 }
 
 #define vektor_ensure(a, new_size) \
-    _vektor_ensure((u8 **)&(a).items, &(a).size, (new_size), sizeof(*(a).items), (a)._allocator)
+    (_mrw_here(), _vektor_ensure((u8 **)&(a).items, &(a).size, &(a).n_items, (new_size), sizeof(*(a).items), alignof_expr(*(a).items), (a)._allocator, &(a)._flags), _mrw_here_end())
+
+// exact, room for count items without rounding up
+#define vektor_reserve(a, count) \
+    ((u64)(count) > (a).size ? \
+        (_mrw_here(), _vektor_resize((u8 **)&(a).items, &(a).size, &(a).n_items, (count), sizeof(*(a).items), alignof_expr(*(a).items), (a)._allocator, &(a)._flags), _mrw_here_end()) : (void)0)
+
+// gives the slack past n_items back to the allocator
+#define vektor_shrink_to_fit(a) \
+    (_mrw_here(), _vektor_resize((u8 **)&(a).items, &(a).size, &(a).n_items, (a).n_items, sizeof(*(a).items), alignof_expr(*(a).items), (a)._allocator, &(a)._flags), _mrw_here_end())
 
-#define vektor_add_arr(v, slice) \
+// everything below shifts with block moves, pointers into the vektor itself arent valid sources
+// since it might get reallocated first
+#define vektor_insert_n(v, position, src, count) \
 do { \
-    vektor_ensure((v), (v).n_items + slice_count((slice)));\
-    for (u64 i = 0; i < slice_count((slice)); i++) \
-        (v).items[(v).n_items + i] = (slice).start[i]; \
-    v.n_items += slice_count((slice));\
+    u64 _vektor_pos = (position), _vektor_n = (count); \
+    vektor_ensure((v), max(_vektor_pos, (v).n_items) + _vektor_n); \
+    if (_vektor_pos < (v).n_items) \
+        buf_move((v).items + _vektor_pos + _vektor_n, (v).items + _vektor_pos, ((v).n_items - _vektor_pos) * sizeof(*(v).items)); \
+    buf_copy((v).items + _vektor_pos, (src), _vektor_n * sizeof(*(v).items)); \
+    (v).n_items += _vektor_n; \
 } while (0)
 
+#define vektor_add_arr(v, slice) vektor_insert_n((v), (v).n_items, slice_start((slice)), slice_count((slice)))
+
 #define vektor_insert(v, position, ...) \
 do { \
-    vektor_ensure(v, position);\
-    for (u64 i = v.n_items; i > position; i--) \
-        v.items[i] = v.items[i - 1]; \
-    v.items[position] = (__VA_ARGS__); \
-    v.n_items++;\
+    u64 _vektor_pos = (position); \
+    vektor_ensure((v), max(_vektor_pos, (v).n_items)); \
+    if (_vektor_pos < (v).n_items) \
+        buf_move((v).items + _vektor_pos + 1, (v).items + _vektor_pos, ((v).n_items - _vektor_pos) * sizeof(*(v).items)); \
+    (v).items[_vektor_pos] = (__VA_ARGS__); \
+    (v).n_items++; \
+} while (0)
+
+// removes [from, to)
+#define vektor_remove_range(v, from, to) \
+do { \
+    u64 _vektor_from = (from), _vektor_to = min((u64)(to), (v).n_items); \
+    if (_vektor_from >= _vektor_to) break; \
+    buf_move((v).items + _vektor_from, (v).items + _vektor_to, ((v).n_items - _vektor_to) * sizeof(*(v).items)); \
+    (v).n_items -= _vektor_to - _vektor_from; \
 } while (0)
 
 #define vektor_remove(v, position) \
 do { \
-    if (position >= v.n_items) break; \
-    for (u64 i = position; i < v.n_items - 1; i++) \
-        v.items[i] = v.items[i + 1]; \
-    v.n_items--; \
-}while (0)
+    u64 _vektor_remove_pos = (position); \
+    vektor_remove_range((v), _vektor_remove_pos, _vektor_remove_pos + 1); \
+} while (0)
+
+// O(1), moves the last item into the hole so order isnt kept
+#define vektor_remove_swap(v, position) \
+do { \
+    u64 _vektor_pos = (position); \
+    if (_vektor_pos >= (v).n_items) break; \
+    (v).items[_vektor_pos] = (v).items[--(v).n_items]; \
+} while (0)
 
 #define slice_vektor(v) slice_to((v).items, (v).n_items)
 
+// segmented vektor, items live in segments of 16, 32, 64, ... items that are never moved once
+// allocated, so growing is O(1) without copying and pointers to items stay valid until theyre removed
+
+#ifndef MRW_SEG_VEKTOR_SHIFT
+#define MRW_SEG_VEKTOR_SHIFT 4 // the first segment holds 1 << shift items
+#endif // MRW_SEG_VEKTOR_SHIFT
+
+#ifndef MRW_SEG_VEKTOR_SEGMENTS
+#define MRW_SEG_VEKTOR_SEGMENTS 32
+#endif // MRW_SEG_VEKTOR_SEGMENTS
+
+#define SEG_VEKTOR(item)\
+struct \
+{ \
+    item* segments[MRW_SEG_VEKTOR_SEGMENTS]; \
+    u64 n_items; \
+    u64 size; \
+    Allocator* _allocator; \
+}
+
+// segment k holds (1 << shift) << k items and starts at index ((1 << shift) << k) - (1 << shift)
+static inline u32 _seg_vektor_segment(u64 index) {
+    return u64_log2(index + (1ull << MRW_SEG_VEKTOR_SHIFT)) - MRW_SEG_VEKTOR_SHIFT;
+}
+
+static inline u64 _seg_vektor_offset(u64 index, u32 segment) {
+    return index + (1ull << MRW_SEG_VEKTOR_SHIFT) - ((1ull << MRW_SEG_VEKTOR_SHIFT) << segment);
+}
+
+static inline u64 _seg_vektor_segment_size(u32 segment) {
+    return (1ull << MRW_SEG_VEKTOR_SHIFT) << segment;
+}
+
+// segments arent zeroed, touching the whole thing up front would make the append that
+// crosses into a new segment cost O(segment) again
+static inline void* _seg_vektor_alloc_segment(u32 segment, u64 item_size, u64 item_align, Allocator *a) {
+    if (segment >= MRW_SEG_VEKTOR_SEGMENTS) mrw_abort("seg vektor out of segments");
+    return _mrw_alloc(a, _seg_vektor_segment_size(segment) * item_size, item_align);
+}
+
+#define seg_vektor_init(v, allocator) \
+do { \
+    buf_set((v).segments, 0, sizeof((v).segments)); \
+    (v).n_items = 0; (v).size = 0; (v)._allocator = allocator; \
+} while (0)
+
+#define seg_vektor_free(v) \
+do { \
+    for (u32 _seg_vektor_k = 0; (v).size; _seg_vektor_k++) { \
+        _mrw_free((v)._allocator, (v).segments[_seg_vektor_k], _seg_vektor_segment_size(_seg_vektor_k) * sizeof(**(v).segments)); \
+        (v).segments[_seg_vektor_k] = nullptr; \
+        (v).size -= _seg_vektor_segment_size(_seg_vektor_k); \
+    } \
+    (v).n_items = 0; \
+} while (0)
+
+#define seg_vektor_clear(v) \
+do { \
+    (v).n_items = 0; \
+} while (0)
+
+// allocates segments until index is valid, the existing ones never move
+#define seg_vektor_ensure(v, index) \
+do { \
+    u64 _seg_vektor_index = (index); \
+    while (_seg_vektor_index >= (v).size) { \
+        u32 _seg_vektor_k = _seg_vektor_segment((v).size); \
+        _mrw_here(); \
+        (v).segments[_seg_vektor_k] = _seg_vektor_alloc_segment(_seg_vektor_k, sizeof(**(v).segments), alignof_expr(**(v).segments), (v)._allocator); \
+        (v).size += _seg_vektor_segment_size(_seg_vektor_k); \
+    } \
+} while (0)
+
+// lvalue, index is evaluated more than once
+#define seg_vektor_get(v, index) \
+    ((v).segments[_seg_vektor_segment((index))][_seg_vektor_offset((index), _seg_vektor_segment((index)))])
+
+#define seg_vektor_add(v, ...) \
+do { \
+    seg_vektor_ensure((v), (v).n_items); \
+    seg_vektor_get((v), (v).n_items) = (__VA_ARGS__); \
+    (v).n_items++; \
+} while (0)
+
+#define seg_vektor_pop(v) \
+do { \
+    if ((v).n_items) (v).n_items--; \
+} while (0)
+
+// O(1), moves the last item into the hole so order isnt kept
+#define seg_vektor_remove_swap(v, position) \
+do { \
+    u64 _seg_vektor_pos = (position); \
+    if (_seg_vektor_pos >= (v).n_items) break; \
+    (v).n_items--; \
+    seg_vektor_get((v), _seg_vektor_pos) = seg_vektor_get((v), (v).n_items); \
+} while (0)
+
 #endif // MARROW_VEKTOR_H
@@ -0,0 +1,154 @@
+#ifndef MARROW_VM_H
+#define MARROW_VM_H
+
+#include "marrow.h"
+#include "alloc.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+
+// older bsds and macos only have the short name, freebsd dropped MAP_NORESERVE since it never
+// overcommits anyway
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#ifndef MAP_ANONYMOUS
+#include <fcntl.h>
+#include <unistd.h>
+#endif // MAP_ANONYMOUS
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif // MAP_NORESERVE
+#endif // _WIN32
+
+// reserves a big range of address space up front and commits pages as it grows,
+// so allocations are contiguous, never move and never run out before the reservation does
+#ifndef MRW_VIRTUAL_ARENA_RESERVE
+#define MRW_VIRTUAL_ARENA_RESERVE (64ULL * 1024 * 1024 * 1024)
+#endif // MRW_VIRTUAL_ARENA_RESERVE
+
+#ifndef MRW_VIRTUAL_ARENA_COMMIT
+#define MRW_VIRTUAL_ARENA_COMMIT (64 * 1024)
+#endif // MRW_VIRTUAL_ARENA_COMMIT
+
+typedef struct {
+    Allocator _impl;
+    u8* data;
+    usize reserved;       // 0 -> MRW_VIRTUAL_ARENA_RESERVE, reserved lazily on first alloc
+    usize committed;
+    usize used;
+    usize keep_committed; // bytes that stay committed through a reset
+} VirtualArena;
+#define MRW_VIRTUAL_ARENA_IMPL ._impl = { .alloc = _mrw_virtual_arena_alloc, .realloc = _mrw_virtual_arena_realloc, .free = _mrw_fake_free }
+
+#ifndef _WIN32
+// a fresh inaccessible mapping, strict -std=c modes hide MAP_ANONYMOUS so /dev/zero stands in there
+static inline void* _mrw_vm_map(void* at, usize size, int flags)
+{
+#ifdef MAP_ANONYMOUS
+    return mmap(at, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | flags, -1, 0);
+#else
+    int fd = open("/dev/zero", O_RDWR);
+    if (fd < 0) return MAP_FAILED;
+    void* p = mmap(at, size, PROT_NONE, MAP_PRIVATE | MAP_NORESERVE | flags, fd, 0);
+    close(fd);
+    return p;
+#endif // MAP_ANONYMOUS
+}
+#endif // _WIN32
+
+static inline bool _mrw_vm_reserve(VirtualArena* a)
+{
+    if (!a->reserved) a->reserved = MRW_VIRTUAL_ARENA_RESERVE;
+#ifdef _WIN32
+    a->data = (u8*)VirtualAlloc(nullptr, a->reserved, MEM_RESERVE, PAGE_NOACCESS);
+#else
+    void* p = _mrw_vm_map(nullptr, a->reserved, 0);
+    a->data = p == MAP_FAILED ? nullptr : (u8*)p;
+#endif // _WIN32
+    return a->data != nullptr;
+}
+
+static inline bool _mrw_vm_commit(u8* ptr, usize size)
+{
+#ifdef _WIN32
+    return VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+    return mprotect(ptr, size, PROT_READ | PROT_WRITE) == 0;
+#endif // _WIN32
+}
+
+static inline void _mrw_vm_decommit(u8* ptr, usize size)
+{
+#ifdef _WIN32
+    VirtualFree(ptr, size, MEM_DECOMMIT);
+#elif defined(MADV_DONTNEED)
+    madvise(ptr, size, MADV_DONTNEED);
+    mprotect(ptr, size, PROT_NONE);
+#else
+    // mapping fresh pages over the range drops the old ones just the same
+    _mrw_vm_map(ptr, size, MAP_FIXED);
+#endif // _WIN32
+}
+
+// makes sure everything up to used is backed by memory
+static inline bool _mrw_virtual_arena_commit(VirtualArena* a, usize used)
+{
+    if (used <= a->committed) return true;
+    if (used > a->reserved) return false;
+    usize committed = min((used + MRW_VIRTUAL_ARENA_COMMIT - 1) / MRW_VIRTUAL_ARENA_COMMIT * MRW_VIRTUAL_ARENA_COMMIT, a->reserved);
+    if (!_mrw_vm_commit(a->data + a->committed, committed - a->committed)) return false;
+    a->committed = committed;
+    return true;
+}
+
+static inline void* _mrw_virtual_arena_alloc(Allocator* allocator, usize size, usize align)
+{
+    VirtualArena* a = (VirtualArena*)allocator;
+    if (!a->data && !_mrw_vm_reserve(a)) mrw_abort("failed to reserve virtual arena");
+    u8* p = (u8*)ptr_align_up(a->data + a->used, align ? align : 1);
+    usize new_used = (usize)(p - a->data) + size;
+    if (new_used < size || !_mrw_virtual_arena_commit(a, new_used)) mrw_abort("virtual arena out of space");
+    a->used = new_used;
+    return p;
+}
+
+static inline void* _mrw_virtual_arena_realloc(Allocator* allocator, void* ptr, usize old_size, usize new_size, usize align)
+{
+    VirtualArena* a = (VirtualArena*)allocator;
+    if (ptr && (u8*)ptr + old_size == a->data + a->used) {
+        usize offset = (usize)((u8*)ptr - a->data);
+        if (offset + new_size < offset || !_mrw_virtual_arena_commit(a, offset + new_size)) mrw_abort("virtual arena out of space");
+        a->used = offset + new_size;
+        return ptr;
+    }
+    return _mrw_fake_realloc(allocator, ptr, old_size, new_size, align);
+}
+
+static inline usize mrw_virtual_arena_mark(VirtualArena* a) { return a->used; }
+static inline void mrw_virtual_arena_rewind(VirtualArena* a, usize mark) { if (mark < a->used) a->used = mark; }
+
+// hands pages above keep_committed back to the os
+static inline void mrw_virtual_arena_reset(VirtualArena* a)
+{
+    a->used = 0;
+    usize keep = min((a->keep_committed + MRW_VIRTUAL_ARENA_COMMIT - 1) / MRW_VIRTUAL_ARENA_COMMIT * MRW_VIRTUAL_ARENA_COMMIT, a->committed);
+    if (keep < a->committed) _mrw_vm_decommit(a->data + keep, a->committed - keep);
+    a->committed = keep;
+}
+
+static inline void mrw_virtual_arena_release(VirtualArena* a)
+{
+    if (!a->data) return;
+#ifdef _WIN32
+    VirtualFree(a->data, 0, MEM_RELEASE);
+#else
+    munmap(a->data, a->reserved);
+#endif // _WIN32
+    a->data = nullptr;
+    a->committed = a->used = 0;
+}
+
+#endif // MARROW_VM_H